@@ -0,0 +1,4 @@
+g++ -std=gnu++11 -O2 -U_FORTIFY_SOURCE \
+loopback.cpp \
+-o loopback \
+-lpthread -ldl
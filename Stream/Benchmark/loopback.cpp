@@ -0,0 +1,221 @@
+// Server and client over loopback, epoll/poll against io_uring : syscalls and delivery latency.
+// Usage : ./loopback [frames] [interval ms] [frame size] [gso]
+// The syscalls are counted by wrapping the libc functions (no strace needed), for both sides of the process.
+#ifndef _GNU_SOURCE
+	#define _GNU_SOURCE
+#endif
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <cstdarg>
+#include <cstdlib>
+#include <dlfcn.h>
+#include <sys/syscall.h>
+
+#include "../Sources/Network/Server.hpp"
+#include "../Sources/Network/Client.hpp"
+#include "../Sources/Histogram.hpp"
+#include "../Sources/Timer.hpp"
+
+namespace Counters {
+	enum Kind {
+		RECEIVE, SEND, WAIT, RING, OTHER, COUNT
+	};
+	
+	std::atomic<uint64_t> calls[COUNT];
+	
+	void reset() {
+		for(auto& count : calls)
+			count = 0;
+	}
+	uint64_t total() {
+		uint64_t sum = 0;
+		for(auto& count : calls)
+			sum += count;
+		return sum;
+	}
+}
+
+// --- Wrapped libc functions ---
+#define REAL(name) static auto real = reinterpret_cast<decltype(&::name)>(dlsym(RTLD_NEXT, #name))
+
+extern "C" {
+	ssize_t recv(int fd, void* buf, size_t len, int flags) {
+		REAL(recv);
+		Counters::calls[Counters::RECEIVE]++;
+		return real(fd, buf, len, flags);
+	}
+	ssize_t recvfrom(int fd, void* buf, size_t len, int flags, struct sockaddr* addr, socklen_t* addrLen) {
+		REAL(recvfrom);
+		Counters::calls[Counters::RECEIVE]++;
+		return real(fd, buf, len, flags, addr, addrLen);
+	}
+	ssize_t recvmsg(int fd, struct msghdr* msg, int flags) {
+		REAL(recvmsg);
+		Counters::calls[Counters::RECEIVE]++;
+		return real(fd, msg, flags);
+	}
+	int recvmmsg(int fd, struct mmsghdr* msgs, unsigned int count, int flags, struct timespec* timeout) {
+		REAL(recvmmsg);
+		Counters::calls[Counters::RECEIVE]++;
+		return real(fd, msgs, count, flags, timeout);
+	}
+	ssize_t send(int fd, const void* buf, size_t len, int flags) {
+		REAL(send);
+		Counters::calls[Counters::SEND]++;
+		return real(fd, buf, len, flags);
+	}
+	ssize_t sendto(int fd, const void* buf, size_t len, int flags, const struct sockaddr* addr, socklen_t addrLen) {
+		REAL(sendto);
+		Counters::calls[Counters::SEND]++;
+		return real(fd, buf, len, flags, addr, addrLen);
+	}
+	ssize_t sendmsg(int fd, const struct msghdr* msg, int flags) {
+		REAL(sendmsg);
+		Counters::calls[Counters::SEND]++;
+		return real(fd, msg, flags);
+	}
+	int sendmmsg(int fd, struct mmsghdr* msgs, unsigned int count, int flags) {
+		REAL(sendmmsg);
+		Counters::calls[Counters::SEND]++;
+		return real(fd, msgs, count, flags);
+	}
+	int poll(struct pollfd* fds, nfds_t count, int timeout) {
+		REAL(poll);
+		Counters::calls[Counters::WAIT]++;
+		return real(fds, count, timeout);
+	}
+	int epoll_wait(int epfd, struct epoll_event* events, int maxEvents, int timeout) {
+		REAL(epoll_wait);
+		Counters::calls[Counters::WAIT]++;
+		return real(epfd, events, maxEvents, timeout);
+	}
+	ssize_t read(int fd, void* buf, size_t len) {
+		REAL(read);
+		Counters::calls[Counters::OTHER]++;
+		return real(fd, buf, len);
+	}
+	ssize_t write(int fd, const void* buf, size_t len) {
+		REAL(write);
+		Counters::calls[Counters::OTHER]++;
+		return real(fd, buf, len);
+	}
+	// io_uring_enter : submissions and waits in one call
+	long syscall(long number, ...) noexcept {
+		REAL(syscall);
+		Counters::calls[number == __NR_io_uring_enter ? Counters::RING : Counters::OTHER]++;
+		
+		va_list args;
+		va_start(args, number);
+		long a[6];
+		for(long& arg : a)
+			arg = va_arg(args, long);
+		va_end(args);
+		
+		return real(number, a[0], a[1], a[2], a[3], a[4], a[5]);
+	}
+}
+
+// --- Structures ---
+struct Result {
+	bool wanted = false;
+	bool uring = false;
+	size_t received = 0;
+	double seconds = 0;
+	uint64_t calls[Counters::COUNT] = {};
+	Histogram::Summary latency;
+};
+
+// --- One run : a frame every interval, its send time inside ---
+static Result run(bool uring, int port, size_t frames, int intervalMs, size_t frameSize, bool gso) {
+	Result result;
+	result.wanted = uring;
+	Histogram latency;
+	std::atomic<size_t> received(0);
+	
+	Server server;
+	server.preferUring(uring);
+	server.connectAt(port);
+	server.setSegmentOffload(gso);
+	
+	Client client;
+	client.preferUring(uring);
+	client.onData([&](const MessageView& message) {
+		uint64_t sent = 0;
+		if(message.size() < sizeof(sent))
+			return;
+		
+		memcpy(&sent, message.content(), sizeof(sent));
+		latency.add(Timer::monotonicMus() - sent);
+		received++;
+	});
+	client.connectTo("127.0.0.1", port);
+	
+	for(Timer timer; !client.isConnected() && timer.elapsed_mus() < 2000000; timer.wait(1)) {
+	}
+	if(!client.isConnected()) {
+		std::cout << "Could not connect on port " << port << std::endl;
+		return result;
+	}
+	result.uring = server.isUring() && client.isUring();
+	
+	std::vector<char> payload(frameSize, 'x');
+	const std::vector<Server::ClientInfo> clients = server.getClients();
+	
+	Counters::reset();
+	Timer timer;
+	for(size_t i = 0; i < frames; i++) {
+		const uint64_t now = Timer::monotonicMus();
+		memcpy(payload.data(), &now, sizeof(now));
+		server.broadcastData(clients, Message(Message::CAMERA, payload.data(), payload.size()));
+		
+		std::this_thread::sleep_for(std::chrono::milliseconds(intervalMs));
+	}
+	for(Timer wait; received < frames && wait.elapsed_mus() < 500000; wait.wait(1)) {
+	}
+	result.seconds = timer.elapsed_mus() / 1e6;
+	
+	for(int kind = 0; kind < Counters::COUNT; kind++)
+		result.calls[kind] = Counters::calls[kind];
+	result.received = received;
+	result.latency 	= latency.summary();
+	
+	client.disconnect();
+	server.disconnect();
+	return result;
+}
+
+static void print(const std::string& name, const Result& result, size_t frames) {
+	uint64_t total = 0;
+	for(uint64_t count : result.calls)
+		total += count;
+	
+	std::cout << std::left << std::setw(10) << name << (result.wanted && !result.uring ? "(epoll fallback) " : "")
+		<< "frames " << result.received << "/" << frames
+		<< "  syscalls " << total << " (" << (uint64_t)(total / result.seconds) << "/s, " << std::setprecision(3) << (double)total / frames << "/frame)"
+		<< "  [recv " << result.calls[Counters::RECEIVE] << ", send " << result.calls[Counters::SEND] << ", wait " << result.calls[Counters::WAIT] 
+		<< ", io_uring_enter " << result.calls[Counters::RING] << ", other " << result.calls[Counters::OTHER] << "]"
+		<< "  latency p50 " << result.latency.p50 << " us, p99 " << result.latency.p99 << " us" << std::endl;
+}
+
+// --- Entry point ---
+int main(int argc, char* argv[]) {
+	const size_t frames 	= argc > 1 ? (size_t)std::atoi(argv[1]) : 1000;
+	const int intervalMs 	= argc > 2 ? std::atoi(argv[2]) : 5;
+	const size_t frameSize 	= argc > 3 ? (size_t)std::atoi(argv[3]) : 60000;
+	const bool gso 			= argc > 4 && std::atoi(argv[4]) != 0;
+	
+	std::cout << frames << " frames of " << frameSize << " bytes every " << intervalMs << " ms, segmentation offload " << (gso ? "on" : "off") << std::endl;
+	
+	const Result epoll = run(false, 9870, frames, intervalMs, frameSize, gso);
+	print("epoll", epoll, frames);
+	
+	const Result uring = run(true, 9871, frames, intervalMs, frameSize, gso);
+	print("io_uring", uring, frames);
+	
+	return 0;
+}
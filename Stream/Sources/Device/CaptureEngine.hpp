@@ -0,0 +1,296 @@
+#pragma once
+#ifdef __linux__
+
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <memory>
+#include <functional>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cstdio>
+#include <cstdint>
+#include <cerrno>
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include "Device.hpp"
+#include "FrameHub.hpp"
+#include "structures.hpp"
+
+// ------------ CaptureEngine : Pull frames of several devices in a single thread ------------
+// Every device descriptor is in one epoll. Frames grabbed at the same wake up are published by timestamp,
+// each device has its own pipeline (FrameHub) for its subscribers.
+class CaptureEngine {
+public:
+	// Structures
+	struct Stats {
+		uint64_t frames 		= 0; // Frames published
+		uint64_t spurious 	= 0; // Wake ups without frame (corrupted frame, timer slot missed)
+		uint64_t errors 		= 0; // Grab or retrieve failed
+		uint64_t lastTimestamp = 0; // Last frame published (mus, monotonic)
+		bool failed 			= false; // Removed from the loop after too many errors
+	};
+
+	// Constructor
+	CaptureEngine() : _running(false), _epfd(-1), _stopFd(-1) {
+		// Wait for add
+	}
+
+	// Destructor
+	~CaptureEngine() {
+		release();
+	}
+
+	// - Methods
+	// Open a device and return its id, -1 on failure. Only before start().
+	int add(const std::string& path) {
+		if(_running)
+			return -1;
+
+		std::shared_ptr<_Camera> camera = std::make_shared<_Camera>(path);
+		if(!camera->device->open() || camera->device->fd() == -1) {
+			camera->device->close();
+			return -1;
+		}
+
+		std::lock_guard<std::mutex> lockDevices(_mutDevices);
+		_cameras.push_back(camera);
+		return static_cast<int>(_cameras.size() - 1);
+	}
+
+	// Add a subscriber to a device pipeline. Return its id, -1 if the device is unknown.
+	int subscribe(int idCamera, const FrameHub::Callback& cbkFrame, const FrameHub::Options& options = FrameHub::Options()) {
+		if(!_isCamera(idCamera))
+			return -1;
+
+		return _cameras[idCamera]->hub.subscribe(cbkFrame, options);
+	}
+	bool unsubscribe(int idCamera, int idSubscriber) {
+		if(!_isCamera(idCamera))
+			return false;
+
+		return _cameras[idCamera]->hub.unsubscribe(idSubscriber);
+	}
+
+	bool start() {
+		if(_running || _cameras.empty())
+			return false;
+
+		_epfd 	= epoll_create1(EPOLL_CLOEXEC);
+		_stopFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+		if(_epfd == -1 || _stopFd == -1 || !_watch(_stopFd, _STOP)) {
+			perror(" [CaptureEngine] Creating epoll");
+			_closeFds();
+			return false;
+		}
+
+		for(size_t id = 0; id < _cameras.size(); id++) {
+			if(!_watch(_cameras[id]->device->fd(), static_cast<uint32_t>(id))) {
+				perror((" [CaptureEngine] Watching " + _cameras[id]->path).c_str());
+				_closeFds();
+				return false;
+			}
+		}
+
+		_running = true;
+		_pThread = std::make_shared<std::thread>(&CaptureEngine::_loop, this);
+
+		return true;
+	}
+
+	// Stop the loop, then close every device
+	void release() {
+		_running = false;
+
+		if(_stopFd != -1) {
+			uint64_t one = 1;
+			if(write(_stopFd, &one, sizeof(one)) != sizeof(one))
+				perror(" [CaptureEngine] Stopping");
+		}
+
+		if(_pThread)
+			if(_pThread->joinable())
+				_pThread->join();
+
+		_pThread.reset();
+		_closeFds();
+
+		std::lock_guard<std::mutex> lockDevices(_mutDevices);
+		for(auto& camera : _cameras) {
+			camera->hub.clear();
+			camera->device->close();
+		}
+		_cameras.clear();
+	}
+
+	// Setters : the loop doesn't grab while they run, the descriptors stay the same
+	bool setFormat(int idCamera, int width, int height, Device::PixelFormat formatPix) {
+		if(!_isCamera(idCamera))
+			return false;
+
+		std::lock_guard<std::mutex> lockDevices(_mutDevices);
+		return _cameras[idCamera]->device->setFormat(width, height, formatPix);
+	}
+	bool setFrameRate(int idCamera, double fps) {
+		if(!_isCamera(idCamera))
+			return false;
+
+		std::lock_guard<std::mutex> lockDevices(_mutDevices);
+		return _cameras[idCamera]->device->setFrameRate(fps);
+	}
+	bool set(int idCamera, Device::Param code, double value) {
+		if(!_isCamera(idCamera))
+			return false;
+
+		std::lock_guard<std::mutex> lockDevices(_mutDevices);
+		return _cameras[idCamera]->device->set(code, value);
+	}
+
+	// Getters
+	size_t count() const {
+		return _cameras.size();
+	}
+	bool isRunning() const {
+		return _running;
+	}
+	bool getStats(int idCamera, Stats& stats) const {
+		if(!_isCamera(idCamera))
+			return false;
+
+		std::lock_guard<std::mutex> lockDevices(_mutDevices);
+		stats = _cameras[idCamera]->stats;
+		return true;
+	}
+	const Device::FrameFormat getFormat(int idCamera) const {
+		if(!_isCamera(idCamera))
+			return Device::FrameFormat {0,0,0};
+
+		std::lock_guard<std::mutex> lockDevices(_mutDevices);
+		return _cameras[idCamera]->device->getFormat();
+	}
+
+private:
+	// Constants
+	static const uint32_t _STOP 		= UINT32_MAX;	// epoll data of the stop event
+	static const uint32_t _MAX_ERRORS = 10;		// In a row, before the device is removed
+
+	// Structures
+	struct _Camera {
+		explicit _Camera(const std::string& path_) :
+			path(path_), device(std::make_shared<Device>(path_)), errorsInRow(0)
+		{
+		}
+
+		std::string path;
+		std::shared_ptr<Device> device;
+		FrameHub hub;
+		Stats stats;
+		uint32_t errorsInRow;
+	};
+	struct _Grabbed {
+		uint32_t idCamera;
+		std::shared_ptr<Gb::Frame> frame;
+	};
+
+	// Methods
+	bool _isCamera(int idCamera) const {
+		return idCamera >= 0 && static_cast<size_t>(idCamera) < _cameras.size();
+	}
+	bool _watch(int fd, uint32_t id) {
+		struct epoll_event event = {};
+		event.events 	= EPOLLIN;
+		event.data.u32 	= id;
+		return epoll_ctl(_epfd, EPOLL_CTL_ADD, fd, &event) == 0;
+	}
+	void _closeFds() {
+		if(_epfd != -1)
+			close(_epfd);
+		if(_stopFd != -1)
+			close(_stopFd);
+
+		_epfd 	= -1;
+		_stopFd = -1;
+	}
+
+	void _loop() {
+		std::vector<struct epoll_event> events(_cameras.size() + 1);
+		std::vector<_Grabbed> grabbed;
+		grabbed.reserve(_cameras.size());
+
+		while(_running) {
+			int nEvents = epoll_wait(_epfd, events.data(), static_cast<int>(events.size()), 1000);
+			if(nEvents == -1) {
+				if(errno == EINTR)
+					continue;
+
+				perror(" [CaptureEngine] Waiting for frames");
+				break;
+			}
+
+			// Dequeue everything ready
+			grabbed.clear();
+			_mutDevices.lock();
+			for(int i = 0; i < nEvents; i++) {
+				const uint32_t id = events[i].data.u32;
+				if(id == _STOP)
+					continue;
+
+				_Camera& camera(*_cameras[id]);
+				if(!camera.device->tryGrab()) {
+					// Level triggered : a broken device would wake us up forever
+					if(events[i].events & (EPOLLERR | EPOLLHUP))
+						_onError(camera);
+					else
+						camera.stats.spurious++;
+					continue;
+				}
+
+				_Grabbed item = {id, std::make_shared<Gb::Frame>()};
+				if(!camera.device->retrieve(*item.frame)) {
+					_onError(camera);
+					continue;
+				}
+
+				camera.errorsInRow = 0;
+				camera.stats.frames++;
+				camera.stats.lastTimestamp = item.frame->timestamp;
+				grabbed.push_back(item);
+			}
+			_mutDevices.unlock();
+
+			// Same order for every run : exposure time, then device
+			std::sort(grabbed.begin(), grabbed.end(), [](const _Grabbed& a, const _Grabbed& b) {
+				return a.frame->timestamp != b.frame->timestamp ? a.frame->timestamp < b.frame->timestamp : a.idCamera < b.idCamera;
+			});
+
+			for(const _Grabbed& item : grabbed)
+				_cameras[item.idCamera]->hub.publish(FrameHub::FramePtr(item.frame));
+		}
+	}
+	void _onError(_Camera& camera) {
+		camera.stats.errors++;
+
+		if(++camera.errorsInRow < _MAX_ERRORS || camera.stats.failed)
+			return;
+
+		camera.stats.failed = true;
+		epoll_ctl(_epfd, EPOLL_CTL_DEL, camera.device->fd(), nullptr);
+		perror((" [CaptureEngine] Removing " + camera.path).c_str());
+	}
+
+	// Members
+	std::atomic<bool> _running;
+	std::shared_ptr<std::thread> _pThread;
+
+	int _epfd;
+	int _stopFd;
+
+	mutable std::mutex _mutDevices;
+	std::vector<std::shared_ptr<_Camera>> _cameras; // Fixed once started
+};
+
+#endif
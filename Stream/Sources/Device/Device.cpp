@@ -9,6 +9,8 @@
 #include <mutex>
 #include <functional>
 
+#include "Device_backend.hpp"
+
 // ----------  Implementation linux ----------
 #ifdef __linux__
 
@@ -21,15 +23,43 @@
 	
 #endif
 
+// ---------- Software sources ------------
+#include "Device_impl_file.hpp"
+#include "Device_impl_synthetic.hpp"
+
 // --------- Interface publique ------------
 // Constructors
-Device::Device(const std::string& pathVideo) : _impl(new _Impl(pathVideo)) {
+Device::Device(const std::string& pathVideo) : _impl(_createBackend(pathVideo)) {
 	// Wait open
 }
 Device::~Device() {
 	delete _impl;
 }
 
+// Source chosen from the path scheme
+Device::_Backend* Device::_createBackend(const std::string& pathVideo) {
+	size_t colon = pathVideo.find(':');
+	std::string scheme = colon != std::string::npos ? pathVideo.substr(0, colon) : "";
+	
+	if(scheme == "file" || scheme == "synthetic") {
+		std::string path = pathVideo.substr(colon + 1);
+		std::string query;
+		
+		size_t mark = path.find('?');
+		if(mark != std::string::npos) {
+			query = path.substr(mark + 1);
+			path  = path.substr(0, mark);
+		}
+		
+		if(scheme == "file")
+			return new _ImplFile(path, query);
+		else
+			return new _ImplSynthetic(path, query);
+	}
+	
+	return new _Impl(pathVideo);
+}
+
 // Flow
 bool Device::open() {
 	return _impl->open();
@@ -42,6 +72,9 @@ bool Device::close() {
 bool Device::grab() {
 	return _impl->grab();
 }
+bool Device::tryGrab() {
+	return _impl->tryGrab();
+}
 bool Device::retrieve(Gb::Frame& frame) {
 	return _impl->retrieve(frame);
 }
@@ -53,17 +86,32 @@ bool Device::read(Gb::Frame& frame) {
 bool Device::setFormat(int width, int height, PixelFormat formatPix) {
 	return _impl->setFormat(width, height, formatPix);
 }
+bool Device::setFrameRate(double fps) {
+	return _impl->setFrameRate(fps);
+}
 bool Device::set(Param code, double value) {
 	return _impl->set(code, value);
 }
+bool Device::set(const ParamList& params) {
+	return _impl->set(params);
+}
 
 // Getters
 const Device::FrameFormat Device::getFormat() const {
 	return _impl->getFormat();
 }
+double Device::getFrameRate() {
+	return _impl->getFrameRate();
+}
+const Device::CaptureStats Device::getCaptureStats() const {
+	return _impl->getCaptureStats();
+}
 double Device::get(Param code) {
 	return _impl->get(code);
 }
+int Device::fd() {
+	return _impl->fd();
+}
 
 
 
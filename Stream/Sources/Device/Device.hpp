@@ -2,6 +2,9 @@
 
 #include "structures.hpp"
 
+#include <vector>
+#include <utility>
+
 class Device {
 public:
 	// Structures
@@ -14,6 +17,12 @@ public:
 		int height;
 		int format;	
 	};
+	struct CaptureStats {
+		uint64_t grabbed	= 0;	// Frames dequeued from the driver
+		uint64_t rejected	= 0;	// Corrupted frames, never given to retrieve
+		uint64_t trimmed	= 0;	// Frames with padding removed
+		uint64_t dropped	= 0;	// Frames lost by the driver (gaps in the sequence)
+	};
 	
 	// Enums
 	enum PixelFormat {
@@ -36,9 +45,33 @@ public:
 		MaxExposure 		= Exposure | Maximum,
 		DefaultExposure 	= Exposure | Default,
 		AutoExposure 		= Exposure | Automatic,
+		
+		Gain			= (1 << 7),
+		MinGain 			= Gain | Minimum,
+		MaxGain 			= Gain | Maximum,
+		DefaultGain 		= Gain | Default,
+		
+		Brightness		= (1 << 8),
+		MinBrightness 		= Brightness | Minimum,
+		MaxBrightness 		= Brightness | Maximum,
+		DefaultBrightness 	= Brightness | Default,
+		
+		WhiteBalance		= (1 << 9),
+		MinWhiteBalance 		= WhiteBalance | Minimum,
+		MaxWhiteBalance 		= WhiteBalance | Maximum,
+		DefaultWhiteBalance 	= WhiteBalance | Default,
+		AutoWhiteBalance 		= WhiteBalance | Automatic,
+		
+		Focus			= (1 << 10),
+		MinFocus 			= Focus | Minimum,
+		MaxFocus 			= Focus | Maximum,
+		DefaultFocus 		= Focus | Default,
+		AutoFocus 			= Focus | Automatic,
 	};
+	typedef std::vector<std::pair<Param, double>> ParamList;
 	
 	// Constructors
+	// pathVideo : camera ("/dev/video0", "0"), mjpeg replay ("file:clip.mjpg?fps=30") or generated frames ("synthetic:640x480?fps=0")
 	explicit Device(const std::string& pathVideo);
 	~Device();
 	
@@ -47,21 +80,33 @@ public:
 	bool close();
 	
 	bool grab();
+	bool tryGrab();	// Non blocking grab, for event loops : false if no frame is ready
 	bool retrieve(Gb::Frame& frame);
 	bool read(Gb::Frame& frame);
 	
 	// Setters
 	bool setFormat(int width, int height, PixelFormat formatPix);
+	bool setFrameRate(double fps);
 	bool set(Param code, double value);
+	bool set(const ParamList& params); // Applied together when the driver allows it
 	
 	// Getters
 	const FrameFormat getFormat() const;
+	double getFrameRate();
+	const CaptureStats getCaptureStats() const;
 	double get(Param code);
+	int fd();		// Readable when tryGrab may succeed, -1 if the device can't be waited on
 	
 
 	
 private:
-	// Private implementation - OS dependent
+	// Private implementation - Camera : OS dependent. Replay and generated frames : portable.
+	struct _Backend;
 	struct _Impl;
-	_Impl* _impl = nullptr;
+	struct _ImplFile;
+	struct _ImplSynthetic;
+	
+	static _Backend* _createBackend(const std::string& pathVideo);
+	
+	_Backend* _impl = nullptr;
 };
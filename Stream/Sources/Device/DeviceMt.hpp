@@ -4,14 +4,26 @@
 #include <thread>
 #include <mutex>
 #include <chrono>
+#include <memory>
+#include <functional>
 
 #include "Device.hpp"
+#include "FrameHub.hpp"
 #include "structures.hpp"
 #include "../Timer.hpp"
+#include "../Histogram.hpp"
 
 // ------------ Device : Pull frames in a dedicated thread ------------
 class DeviceMt {	
 public:
+	// Latency since the start of exposure, at each stage
+	enum Stage {
+		Dequeued,	// Given by the driver
+		Retrieved,	// Copied out of the driver buffer
+		Delivered,	// Callback entry
+		StageCount
+	};
+	
 	// Constructor
 	DeviceMt() : _running(false) {
 		// Wait for open
@@ -42,6 +54,7 @@ public:
 		
 		// Start threading		
 		_running = true;
+		_cpuMus = 0;
 		_pThread = std::make_shared<std::thread>(&DeviceMt::_pullCapture, this);
 		
 		return true;
@@ -54,6 +67,17 @@ public:
 		_mutCbk.unlock();
 	}
 	
+	// Add a subscriber, called in its own thread. Return its id.
+	virtual int subscribe(const FrameHub::Callback& cbkFrame, const FrameHub::Options& options = FrameHub::Options()) {
+		return _hub.subscribe([this, cbkFrame](const Gb::Frame& frame) {
+			_record(Delivered, frame.timestamp, Timer::monotonicMus());
+			cbkFrame(frame);
+		}, options);
+	}
+	virtual bool unsubscribe(int id) {
+		return _hub.unsubscribe(id);
+	}
+	
 	// Stop threading and releasing _cap
 	virtual void release() {
 		// Nothing to update
@@ -63,6 +87,8 @@ public:
 		_cbkFrame = nullptr;
 		_mutCbk.unlock();
 		
+		_hub.clear();
+		
 		// Wait thread to end
 		if(_pThread)
 			if(_pThread->joinable())
@@ -86,11 +112,23 @@ public:
 		}
 		return false;
 	}
+	bool setFrameRate(double fps) {
+		if(_pDevice) {
+			std::lock_guard<std::mutex> lockDevice(_mutDevice);
+			return _pDevice->setFrameRate(fps);
+		}
+		return false;
+	}
 	bool set(Device::Param code, double value) {
 		if(_pDevice)
 			return _pDevice->set(code, value);
 		return false;
 	}
+	bool set(const Device::ParamList& params) {
+		if(_pDevice)
+			return _pDevice->set(params);
+		return false;
+	}
 	
 	// Getters
 	bool isOpened() {
@@ -103,12 +141,39 @@ public:
 		
 		return Device::FrameFormat {0,0,0};
 	}
+	const Device::CaptureStats getCaptureStats() const {
+		if(_pDevice)
+			return _pDevice->getCaptureStats();
+		
+		return Device::CaptureStats();
+	}
 	double get(Device::Param code) {
 		if(_pDevice)
 			return _pDevice->get(code);
 		
 		return false;
 	}
+	double getFrameRate() {
+		if(_pDevice) {
+			std::lock_guard<std::mutex> lockDevice(_mutDevice);
+			return _pDevice->getFrameRate();
+		}
+		return 0.0;
+	}
+	// Cpu time used by the capture thread since open (mus)
+	uint64_t getCaptureCpuMus() const {
+		return _cpuMus;
+	}
+	bool getStats(int idSubscriber, FrameHub::Stats& stats) const {
+		return _hub.getStats(idSubscriber, stats);
+	}
+	const Histogram::Summary getLatency(Stage stage) const {
+		return _latencies[stage].summary();
+	}
+	void resetLatencies() {
+		for(Histogram& latency : _latencies)
+			latency.reset();
+	}
 	
 protected:
 	// - Members
@@ -119,10 +184,14 @@ protected:
 	virtual void _onFrame() {
 		_mutCbk.lock();
 		
-		if(_cbkFrame) 
+		if(_cbkFrame) {
+			_record(Delivered, frame.timestamp, Timer::monotonicMus());
 			_cbkFrame(frame);					// Call back if set
+		}
+		
+		_mutCbk.unlock();
 		
-		_mutCbk.unlock();		
+		_hub.publish(frame);				// Subscribers, in their own threads
 	}
 	
 private:	
@@ -133,15 +202,26 @@ private:
 			_pDevice->grab(); 				// Will wait until the camera is available
 			
 			_mutFrame.lock();
-			if(_pDevice->retrieve(frame))
+			if(_pDevice->retrieve(frame)) {
+				_record(Dequeued, frame.timestamp, frame.dequeued);
+				_record(Retrieved, frame.timestamp, Timer::monotonicMus());
 				_onFrame();
+			}
+			
+			_mutFrame.unlock();
 			
-			_mutFrame.unlock();			
+			_cpuMus = Timer::threadCpuMus();
 		}
 	}
 	
+	void _record(Stage stage, uint64_t exposed, uint64_t now) {
+		if(exposed > 0 && now >= exposed)
+			_latencies[stage].add(now - exposed);
+	}
+	
 	// Members	
 	std::atomic<bool> _running = {false};
+	std::atomic<uint64_t> _cpuMus = {0};
 	std::shared_ptr<std::thread> _pThread;
 	
 	mutable std::mutex _mutFrame;
@@ -150,4 +230,7 @@ private:
 	
 	std::shared_ptr<Device> _pDevice;
 	std::function<void(const Gb::Frame&)> _cbkFrame;
+	
+	FrameHub _hub;
+	Histogram _latencies[StageCount];
 };
@@ -0,0 +1,168 @@
+#pragma once
+
+#include <chrono>
+#include <thread>
+#include <string>
+#include <cstdlib>
+#include <cstdint>
+
+#ifdef __linux__
+	#include <sys/timerfd.h>
+	#include <unistd.h>
+#endif
+
+#include "Device.hpp"
+
+// ------------ Interface of every source behind Device ------------
+struct Device::_Backend {
+	virtual ~_Backend() {
+	}
+
+	// Methods
+	virtual bool open() = 0;
+	virtual bool close() = 0;
+
+	virtual bool grab() = 0;
+	virtual bool tryGrab() = 0;
+	virtual bool retrieve(Gb::Frame& frame) = 0;
+	virtual bool read(Gb::Frame& frame) = 0;
+
+	// Setters
+	virtual bool setFormat(int width, int height, PixelFormat formatPix) = 0;
+	virtual bool setFrameRate(double fps) = 0;
+	virtual bool set(Device::Param code, double value) = 0;
+	virtual bool set(const ParamList& params) = 0;
+
+	// Getters
+	virtual const FrameFormat getFormat() const = 0;
+	virtual double getFrameRate() = 0;
+	virtual const CaptureStats getCaptureStats() const = 0;
+	virtual double get(Device::Param code) = 0;
+	virtual int fd() = 0;
+};
+
+// ------------ Helpers for the software sources ------------
+namespace DeviceBackend {
+	// Value of an option in "scheme:path?key=value&key=value"
+	inline std::string option(const std::string& query, const std::string& key, const std::string& defaultValue = "") {
+		size_t pos = 0;
+		while(pos < query.size()) {
+			size_t end = query.find('&', pos);
+			if(end == std::string::npos)
+				end = query.size();
+
+			size_t eq = query.find('=', pos);
+			if(eq != std::string::npos && eq < end && query.compare(pos, eq - pos, key) == 0)
+				return query.substr(eq + 1, end - eq - 1);
+
+			pos = end + 1;
+		}
+		return defaultValue;
+	}
+	inline double option(const std::string& query, const std::string& key, double defaultValue) {
+		std::string value = option(query, key);
+		return value.empty() ? defaultValue : std::atof(value.c_str());
+	}
+
+	// Wait for the next frame slot. fps <= 0 : as fast as possible
+	class Pacer {
+	public:
+		Pacer() : _fps(0.0), _started(false), _fd(-1) {
+		}
+		~Pacer() {
+	#ifdef __linux__
+			if(_fd != -1)
+				::close(_fd);
+	#endif
+		}
+		Pacer(const Pacer&) = delete;
+		Pacer& operator=(const Pacer&) = delete;
+
+		void setFrameRate(double fps) {
+			_fps = fps;
+			_started = false;
+			_arm();
+		}
+		double frameRate() const {
+			return _fps;
+		}
+
+		void wait() {
+			if(_fps <= 0)
+				return;
+
+			const auto period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / _fps));
+			const auto now = std::chrono::steady_clock::now();
+
+			if(!_started || now > _next + 4*period) { // First frame, or too late to catch up
+				_next = now;
+				_started = true;
+			}
+
+			std::this_thread::sleep_until(_next);
+			_next += period;
+		}
+
+		// Non blocking : true if a frame slot is reached
+		bool poll() {
+			if(_fps <= 0)
+				return true;
+
+	#ifdef __linux__
+			if(_fd != -1) {
+				uint64_t expirations = 0;
+				return ::read(_fd, &expirations, sizeof(expirations)) == sizeof(expirations) && expirations > 0;
+			}
+	#endif
+
+			const auto period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / _fps));
+			const auto now = std::chrono::steady_clock::now();
+
+			if(!_started || now > _next + 4*period) {
+				_next = now;
+				_started = true;
+			}
+			if(now < _next)
+				return false;
+
+			_next += period;
+			return true;
+		}
+
+		// Timer readable at each frame slot, created at the first call. -1 if not available.
+		int fd() {
+	#ifdef __linux__
+			if(_fd == -1) {
+				_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+				_arm();
+			}
+	#endif
+			return _fd;
+		}
+
+	private:
+		void _arm() {
+	#ifdef __linux__
+			if(_fd == -1)
+				return;
+
+			struct itimerspec spec = {};
+			if(_fps > 0) {
+				const uint64_t periodNs = static_cast<uint64_t>(1e9 / _fps);
+				spec.it_interval.tv_sec 	= static_cast<time_t>(periodNs / 1000000000ULL);
+				spec.it_interval.tv_nsec 	= static_cast<long>(periodNs % 1000000000ULL);
+				spec.it_value 				= spec.it_interval;
+			}
+			else {
+				spec.it_value.tv_nsec = 1; // Expires once, never read : always readable
+			}
+			timerfd_settime(_fd, 0, &spec, nullptr);
+	#endif
+		}
+
+		double _fps;
+		bool _started;
+		std::chrono::steady_clock::time_point _next;
+		int _fd;
+	};
+}
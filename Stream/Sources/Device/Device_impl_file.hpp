@@ -0,0 +1,233 @@
+#pragma once
+
+#include "Device_backend.hpp"
+#include "MjpegScanner.hpp"
+#include "../Timer.hpp"
+
+#include <cstdio>
+#include <vector>
+#include <string>
+#include <algorithm>
+
+#ifdef __linux__
+	#include <dirent.h>
+	#include <sys/stat.h>
+#endif
+
+// ------------ Replay of a mjpeg file (concatenated jpegs) or of a directory of jpegs ------------
+// Path : "file:/path/video.mjpg?fps=30&loop=1". fps=0 : as fast as possible.
+struct Device::_ImplFile : public Device::_Backend {
+public:
+	// Constructors
+	explicit _ImplFile(const std::string& path, const std::string& query) :
+		_path(path),
+		_loop(DeviceBackend::option(query, "loop", 1.0) != 0),
+		_format({0, 0, MJPG}),
+		_iFrame(0),
+		_iCurrent(0),
+		_timestamp(0)
+	{
+		_pacer.setFrameRate(DeviceBackend::option(query, "fps", 30.0));
+	}
+
+	// Methods
+	bool open() {
+		_data.clear();
+		_frames.clear();
+
+		std::vector<std::string> files;
+		if(_isDirectory(_path))
+			files = _listJpegs(_path);
+		else
+			files.push_back(_path);
+
+		// Everything in memory : the disk won't be measured
+		for(const std::string& file : files)
+			_load(file);
+
+		if(_frames.empty()) {
+			perror((" [" + _path + "] No frame to replay").c_str());
+			return false;
+		}
+
+		_iFrame = 0;
+		_pacer.setFrameRate(_pacer.frameRate());
+		return true;
+	}
+	bool close() {
+		_data.clear();
+		_frames.clear();
+		return true;
+	}
+
+	bool grab() {
+		if(!_hasNext())
+			return false;
+
+		_pacer.wait();
+		_next();
+
+		return true;
+	}
+	bool tryGrab() {
+		if(!_hasNext() || !_pacer.poll())
+			return false;
+
+		_next();
+		return true;
+	}
+	bool retrieve(Gb::Frame& frame) {
+		if(_iCurrent >= _frames.size())
+			return false;
+
+		const _Slice& slice(_frames[_iCurrent]);
+		frame = Gb::Frame(&_data[slice.offset], slice.length, slice.size);
+		frame.timestamp = _timestamp;
+		frame.dequeued 	= _timestamp;
+		frame.sequence 	= static_cast<uint32_t>(_stats.grabbed);
+
+		_format.width  = slice.size.width;
+		_format.height = slice.size.height;
+
+		return !frame.empty();
+	}
+	bool read(Gb::Frame& frame) {
+		return (grab() && retrieve(frame));
+	}
+
+	// Setters
+	bool setFormat(int, int, PixelFormat formatPix) {
+		return formatPix == MJPG; // The size is the one of the file
+	}
+	bool setFrameRate(double fps) {
+		_pacer.setFrameRate(fps);
+		return true;
+	}
+	bool set(Device::Param, double) {
+		return false;
+	}
+	bool set(const ParamList&) {
+		return false;
+	}
+
+	// Getters
+	const FrameFormat getFormat() const {
+		return _format;
+	}
+	double getFrameRate() {
+		return _pacer.frameRate();
+	}
+	const CaptureStats getCaptureStats() const {
+		return _stats;
+	}
+	double get(Device::Param) {
+		return 0.0;
+	}
+	int fd() {
+		return _pacer.fd();
+	}
+
+private:
+	struct _Slice {
+		size_t offset;
+		size_t length;
+		Gb::Size size;
+	};
+
+	// Statics
+	static bool _isDirectory(const std::string& path) {
+#ifdef __linux__
+		struct stat info;
+		return stat(path.c_str(), &info) == 0 && S_ISDIR(info.st_mode);
+#else
+		return false;
+#endif
+	}
+	static std::vector<std::string> _listJpegs(const std::string& dirPath) {
+		std::vector<std::string> files;
+#ifdef __linux__
+		DIR* dir = opendir(dirPath.c_str());
+		if(!dir)
+			return files;
+
+		for(struct dirent* entry = readdir(dir); entry != nullptr; entry = readdir(dir)) {
+			std::string name(entry->d_name);
+			size_t dot = name.rfind('.');
+			std::string ext = dot == std::string::npos ? "" : name.substr(dot);
+			std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+
+			if(ext == ".jpg" || ext == ".jpeg" || ext == ".mjpg" || ext == ".mjpeg")
+				files.push_back(dirPath + "/" + name);
+		}
+		closedir(dir);
+
+		std::sort(files.begin(), files.end());
+#endif
+		return files;
+	}
+
+	// Methods
+	bool _hasNext() {
+		if(_frames.empty())
+			return false;
+
+		if(_iFrame >= _frames.size()) {
+			if(!_loop)
+				return false;
+			_iFrame = 0;
+		}
+		return true;
+	}
+	void _next() {
+		_iCurrent	= _iFrame++;
+		_timestamp	= Timer::monotonicMus();
+		_stats.grabbed++;
+	}
+	void _load(const std::string& file) {
+		FILE* pFile = fopen(file.c_str(), "rb");
+		if(!pFile)
+			return;
+
+		const size_t begin = _data.size();
+		unsigned char chunk[65536];
+		for(size_t n = 0; (n = fread(chunk, 1, sizeof(chunk), pFile)) > 0; )
+			_data.insert(_data.end(), chunk, chunk + n);
+		fclose(pFile);
+
+		// Split the jpegs
+		for(size_t offset = begin; offset + 4 <= _data.size(); ) {
+			// Next SOI
+			size_t start = offset;
+			while(start + 1 < _data.size() && !(_data[start] == 0xFF && _data[start+1] == 0xD8))
+				start++;
+			if(start + 4 > _data.size())
+				break;
+
+			size_t validLength = 0;
+			if(MjpegScanner::check(&_data[start], _data.size() - start, validLength) != MjpegScanner::Valid) {
+				offset = start + 2;
+				continue;
+			}
+
+			_Slice slice = {start, validLength, Gb::Size(0,0)};
+			MjpegScanner::dimensions(&_data[start], validLength, slice.size.width, slice.size.height);
+			if(slice.size.area() > 0)
+				_frames.push_back(slice);
+
+			offset = start + validLength;
+		}
+	}
+
+	// Members
+	std::string _path;
+	bool _loop;
+	FrameFormat _format;
+	CaptureStats _stats;
+	DeviceBackend::Pacer _pacer;
+
+	std::vector<unsigned char> _data;
+	std::vector<_Slice> _frames;
+	size_t _iFrame;			// Next to grab
+	size_t _iCurrent;		// Grabbed
+	uint64_t _timestamp;
+};
@@ -1,7 +1,9 @@
 #pragma once
 #ifdef __linux__
 
-#include "Device.hpp"
+#include "Device_backend.hpp"
+#include "MjpegScanner.hpp"
+#include "../Timer.hpp"
 
 // Use v4l2
 #include <linux/videodev2.h>
@@ -10,6 +12,10 @@
 #include <sys/mman.h>
 #include <sys/poll.h>
 
+#include <atomic>
+#include <map>
+#include <vector>
+#include <algorithm>
 #include <cstdint>
 #include <cstdio>
 #include <cstring>
@@ -17,14 +23,22 @@
 #include <fcntl.h>
 #include <unistd.h>
 
-struct Device::_Impl {	
+struct Device::_Impl : public Device::_Backend {	
 public:
 	// Constructors
 	explicit _Impl(const std::string& pathVideo) :
 		_fd(-1), 
 		_path(pathVideo), 
 		_format({0, 0, 0}),
-		_buffer({(void*)nullptr, (size_t)0}) 
+		_buffer({(void*)nullptr, (size_t)0}),
+		_iBuffer(-1),
+		_timestamp(0),
+		_dequeued(0),
+		_sequence(0),
+		_hasSequence(false),
+		_exposureMus(0),
+		_framePeriodMus(0),
+		_frameRate(0.0)
 	{
 		// Wait open
 	}
@@ -37,41 +51,35 @@ public:
 	bool open() {
 		_fd = ::open(_path.c_str(), O_RDWR | O_NONBLOCK, 0);
 		
-		if(_fd == -1 || !_initDevice() || !_initMmap()) {
+		if(_fd == -1 || !_initDevice() || !_initMmap() || !_startCapture()) {
 			_perror("Opening device");
-			if(_fd != -1) 
+			if(_fd != -1) {
+				_releaseMmap();
 				::close(_fd);
+				_fd = -1;
+			}
 				
 			return false;
 		}
 		
+		_enumControls();
 		return true;		
 	}
 	bool close() {
-		// Stop capture
-		enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-		if(_xioctl(_fd, VIDIOC_STREAMOFF, &type) == -1) {
-			_perror("Stop Capture");
-			return false;
-		}
+		if(_fd == -1)
+			return true;
 		
-		if(munmap(_buffer.start, _buffer.length) == -1) {
-			_perror("Memory unmap");
-			return false;
-		}
+		// Stop capture, the descriptor is closed anyway
+		bool success = _stopCapture();
+		success = _releaseMmap() && success;
 		
-		if(_fd != -1) {
-			::close(_fd);
-			_fd = -1;
-		}
-		return true;		
+		::close(_fd);
+		_fd = -1;
+		
+		return success;		
 	}
 	
 	bool grab() {
-		struct v4l2_buffer buf = {0};
-		buf.type 	= V4L2_BUF_TYPE_VIDEO_CAPTURE;
-		buf.memory 	= V4L2_MEMORY_MMAP;
-				
 		for(;;) {
 			// Wait event on fd
 			struct pollfd fdp;
@@ -98,28 +106,31 @@ public:
 			}
 		
 			// Grab frame
-			if(_xioctl(_fd, VIDIOC_DQBUF, &buf) == -1) {
-				if(EAGAIN == errno)
-					continue;
-					
-				_perror("Grab Frame");
-				return false;
-			}
-			
-			// Check size
-			_buffer.length = (buf.bytesused > 0) ? buf.bytesused : _buffer.length;	
-			return true;
+			int grabbed = _dequeue();
+			if(grabbed != 0)
+				return grabbed > 0;
 		}
 		return false;		
 	}
+	bool tryGrab() {
+		return _dequeue() > 0;
+	}
 	bool retrieve(Gb::Frame& frame) {
+		if(_iBuffer < 0)
+			return false;
+		
 		_rawData = Gb::Frame(
 			reinterpret_cast<unsigned char*>(_buffer.start), 
 			static_cast<unsigned long>(_buffer.length),
 			Gb::Size(_format.width, _format.height)
 		).clone();
+		_rawData.timestamp = _timestamp;
+		_rawData.exposure  = _exposureDuration();
+		_rawData.sequence  = _sequence;
+		_rawData.dequeued  = _dequeued;
 		
-		_askFrame();
+		_askFrame(static_cast<uint32_t>(_iBuffer));
+		_iBuffer = -1;
 			
 		return _treat(frame);		
 	}
@@ -129,108 +140,182 @@ public:
 	
 	// Setters
 	bool setFormat(int width, int height, PixelFormat formatPix) {
-		close();
+		const FrameFormat format = {width, height, static_cast<int>(formatPix == MJPG ? V4L2_PIX_FMT_MJPEG : V4L2_PIX_FMT_YUYV)};
+		if(!_isSupported(format)) {
+			_perror("Format not supported");
+			return false;
+		}
+		
+		if(format.width == _format.width && format.height == _format.height && format.format == _format.format)
+			return true;
 		
-		_format.width  = width;
-		_format.height = height;
-		_format.format = formatPix == MJPG ? V4L2_PIX_FMT_MJPEG : V4L2_PIX_FMT_YUYV;
+		const FrameFormat previous = _format;
+		_format = format;
 		
-		return open();
+		if(_fd == -1) // Applied at open
+			return true;
+		
+		if(_reconfigure())
+			return true;
+		
+		// Back to a working state
+		_format = previous;
+		_reconfigure();
+		return false;
 	}
-	bool set(Device::Param code, double value) {
-		struct v4l2_control control = {0};
-		struct v4l2_queryctrl queryctrl = {0};
-		
-		// -- Check control	
-		// Id
-		switch(code) {
-			case Saturation: 		control.id = V4L2_CID_SATURATION; 				break;
-			case Exposure: 		control.id = V4L2_CID_EXPOSURE_ABSOLUTE; 	break;
-			case AutoExposure: 	control.id = V4L2_CID_EXPOSURE_AUTO; 			break;
-			
-			default: return false;
-		}
-		if (_isControl(control.id, &queryctrl) < 0) {
-			_perror("Setting Control");
+	bool setFrameRate(double fps) {
+		if(fps <= 0)
 			return false;
-		}
 		
-		// Value
-		if(code == AutoExposure)
-			control.value = value != 0 ? V4L2_EXPOSURE_AUTO : V4L2_EXPOSURE_MANUAL;
-		else
-			control.value = value;
+		_frameRate = fps;
+		if(_fd == -1) // Applied at open
+			return true;
 		
-		if (control.value > queryctrl.maximum || control.value < queryctrl.minimum) {
-			_perror("Set value out of range");
-			return false;			
-		}
+		return _applyFrameRate(true);
+	}
+	bool set(Device::Param code, double value) {
+		return set(ParamList(1, std::make_pair(code, value)));
+	}
+	
+	// Several controls with one syscall. Manual values switch their automatic mode off if needed.
+	bool set(const ParamList& params) {
+		std::vector<struct v4l2_ext_control> controls;
 		
-		// Need change mode ?
-		if((code & Exposure) && !(code & Automatic)) {
-			struct v4l2_control autoControl = {0};
-			autoControl.id 	 = V4L2_CID_EXPOSURE_AUTO;
-			autoControl.value = V4L2_EXPOSURE_MANUAL;
-
-			if (_xioctl(_fd, VIDIOC_S_CTRL, &autoControl) == -1) {
-				_perror("Changing Mode");
+		for(const auto& param : params) {
+			const Device::Param code = param.first;
+			const uint32_t id = _controlId(code);
+			
+			auto itControl = _controls.find(id);
+			if(id == 0 || (code & (Minimum | Maximum | Default)) || itControl == _controls.end()) {
+				_perror("Control not supported");
 				return false;
-			}	
+			}
+			const _Control& control(itControl->second);
+			
+			struct v4l2_ext_control ext = {0};
+			ext.id = id;
+			
+			if(code & Automatic) {
+				ext.value = _modeValue(control, param.second != 0);
+			}
+			else {
+				ext.value = static_cast<int32_t>(param.second);
+				if(ext.value > control.maximum || ext.value < control.minimum) {
+					_perror("Set value out of range");
+					return false;
+				}
+				
+				// Need change mode ?
+				const uint32_t modeId = _modeId(id);
+				auto itMode = _modes.find(modeId);
+				if(itMode != _modes.end() && itMode->second != _manualValue(modeId)) {
+					struct v4l2_ext_control mode = {0};
+					mode.id 	= modeId;
+					mode.value = _manualValue(modeId);
+					controls.push_back(mode);
+				}
+			}
+			
+			controls.push_back(ext);
 		}
 		
-		// Change value
-		if (_xioctl(_fd, VIDIOC_S_CTRL, &control) == -1) {
-			_perror("Setting Control");
+		if(!_applyControls(controls))
 			return false;
+		
+		// Keep the modes, and the exposure duration for the frames timestamps (unit: 100mus)
+		for(const struct v4l2_ext_control& ext : controls) {
+			if(_modes.find(ext.id) != _modes.end())
+				_modes[ext.id] = ext.value;
+			
+			if(ext.id == V4L2_CID_EXPOSURE_ABSOLUTE)
+				_exposureMus = static_cast<uint32_t>(ext.value) * 100;
+			else if(ext.id == V4L2_CID_EXPOSURE_AUTO && ext.value != V4L2_EXPOSURE_MANUAL)
+				_exposureMus = 0;
 		}
+		
 		return true;
 	}
 	
 	// Getters
 	double get(Device::Param code) {
-		struct v4l2_control control = {0};
-		struct v4l2_queryctrl queryctrl = {0};
-		
-		// Define id
-		if(code & Saturation)
-			control.id = V4L2_CID_SATURATION;
-		else if(code & Exposure)
-			control.id = code & Automatic ? V4L2_CID_EXPOSURE_AUTO : V4L2_CID_EXPOSURE_ABSOLUTE;
-		else 
-			return 0.0;
+		const uint32_t id = _controlId(code);
 		
 		// Check control
-		if (_isControl(control.id, &queryctrl) < 0) {
+		auto itControl = _controls.find(id);
+		if(id == 0 || itControl == _controls.end()) {
 			_perror("Getting Control");
 			return 0.0;
 		}
+		const _Control& control(itControl->second);
 		
 		// Return value if asked about a limit
 		if(code & Minimum)
-			return queryctrl.minimum;
+			return control.minimum;
 		else if(code & Maximum)
-			return queryctrl.maximum;
+			return control.maximum;
 		else if(code & Default)
-			return queryctrl.default_value > queryctrl.maximum ? (queryctrl.maximum+queryctrl.minimum)/2 : queryctrl.default_value;
+			return control.defaultValue > control.maximum ? (control.maximum+control.minimum)/2 : control.defaultValue;
+		
+		// Modes are only changed by us
+		auto itMode = _modes.find(id);
+		if(itMode != _modes.end())
+			return itMode->second == _manualValue(id) ? 0 : 1;
 		
 		// -- Return value if not a limit	
-		if (_xioctl(_fd, VIDIOC_G_CTRL, &control) == -1) {
+		struct v4l2_control current = {0};
+		current.id = id;
+		if (_xioctl(_fd, VIDIOC_G_CTRL, &current) == -1) {
 			_perror("Getting Control");
 			return 0.0;
 		}
 		
-		// Special case
-		if(code == AutoExposure)
-			return control.value == V4L2_EXPOSURE_MANUAL ? 0 : 1;
-		
-		return control.value;
+		return current.value;
 	}
 	const FrameFormat getFormat() const {
 		return _format;
 	}
+	int fd() {
+		return _fd;
+	}
+	double getFrameRate() {
+		if(_fd == -1)
+			return _frameRate;
+		
+		struct v4l2_streamparm parm = {0};
+		parm.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+		
+		if(_xioctl(_fd, VIDIOC_G_PARM, &parm) == -1 || parm.parm.capture.timeperframe.numerator == 0) {
+			_perror("Getting Frame Rate");
+			return 0.0;
+		}
+		
+		return static_cast<double>(parm.parm.capture.timeperframe.denominator) / parm.parm.capture.timeperframe.numerator;
+	}
+	const CaptureStats getCaptureStats() const {
+		CaptureStats stats;
+		stats.grabbed 	= _nGrabbed;
+		stats.rejected 	= _nRejected;
+		stats.trimmed 	= _nTrimmed;
+		stats.dropped 	= _nDropped;
+		return stats;
+	}
 	
 private:		
+	// Structures
+	struct _Control {
+		uint32_t id;
+		uint32_t type;
+		int32_t minimum;
+		int32_t maximum;
+		int32_t step;
+		int32_t defaultValue;
+		uint32_t flags;
+		uint64_t menuMask;		// Menu controls : valid indexes
+	};
+	
 	// Statics
+	static const uint32_t _BUFFER_COUNT = 2; // The driver fills one while the other is read
+	
 	static int _xioctl(int fd, int request, void *arg) {
 		int r(-1);
 		do {
@@ -242,24 +327,9 @@ private:
 	
 	// Methods
 	bool _initDevice() {
-		// Format
-		struct v4l2_fmtdesc fmtdesc = {0};
-		fmtdesc.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-		
-		char fourcc[5] = {0};
-		char c, e;
-		int support_grbg10 = 0;
-		printf("  Format \n--------------------\n");
-		while (_xioctl(_fd, VIDIOC_ENUM_FMT, &fmtdesc) == 0) {
-			strncpy(fourcc, (char *)&fmtdesc.pixelformat, 4);
-			if (fmtdesc.pixelformat == V4L2_PIX_FMT_SGRBG10)
-				support_grbg10 = 1;
-				
-			c = fmtdesc.flags & 1? 'C' : ' ';
-			e = fmtdesc.flags & 2? 'E' : ' ';
-			printf("  %s: %c%c %s\n", fourcc, c, e, fmtdesc.description);
-			fmtdesc.index++;
-		}
+		// Formats : only the first time
+		if(_formats.empty())
+			_enumFormats();
 		
 		struct v4l2_format fmt = {0};
 		if(_format.width == 0 || _format.height == 0) {
@@ -268,10 +338,6 @@ private:
 			fmt.fmt.pix.height 		= 480;
 			fmt.fmt.pix.pixelformat = V4L2_PIX_FMT_MJPEG;
 			fmt.fmt.pix.field 		= V4L2_FIELD_ANY;
-			
-			_format.width  = fmt.fmt.pix.width;
-			_format.height = fmt.fmt.pix.height;
-			_format.format = fmt.fmt.pix.pixelformat;
 		}
 		else {
 			fmt.type 					= V4L2_BUF_TYPE_VIDEO_CAPTURE;
@@ -285,60 +351,259 @@ private:
 			_perror("Setting Pixel Format");
 			return false;
 		}
+		
+		// The driver may have adjusted the size
+		_format.width  = fmt.fmt.pix.width;
+		_format.height = fmt.fmt.pix.height;
+		_format.format = fmt.fmt.pix.pixelformat;
+	 
+		// Frame period, used when the exposure is unknown
+		if(_frameRate > 0)
+			_applyFrameRate(false);
+		else
+			_updateFramePeriod();
 	 
+		char fourcc[5] = {0};
 		strncpy(fourcc, (char *)&fmt.fmt.pix.pixelformat, 4);
 		printf( "Selected Camera Mode:\n--------------------\n   Width: %d\n  Height: %d\n PixFmt: %s\n  Field: %d\n",
 					fmt.fmt.pix.width, fmt.fmt.pix.height, fourcc, fmt.fmt.pix.field);
 
 		return true;		
 	}
+	void _enumFormats() {
+		struct v4l2_fmtdesc fmtdesc = {0};
+		fmtdesc.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+		
+		char fourcc[5] = {0};
+		char c, e;
+		printf("  Format \n--------------------\n");
+		while (_xioctl(_fd, VIDIOC_ENUM_FMT, &fmtdesc) == 0) {
+			strncpy(fourcc, (char *)&fmtdesc.pixelformat, 4);
+			c = fmtdesc.flags & 1? 'C' : ' ';
+			e = fmtdesc.flags & 2? 'E' : ' ';
+			printf("  %s: %c%c %s\n", fourcc, c, e, fmtdesc.description);
+			
+			// Discrete sizes. None kept : any size (stepwise)
+			std::vector<Gb::Size>& sizes(_formats[fmtdesc.pixelformat]);
+			
+			struct v4l2_frmsizeenum frmsize = {0};
+			frmsize.pixel_format = fmtdesc.pixelformat;
+			while(_xioctl(_fd, VIDIOC_ENUM_FRAMESIZES, &frmsize) == 0 && frmsize.type == V4L2_FRMSIZE_TYPE_DISCRETE) {
+				sizes.push_back(Gb::Size(frmsize.discrete.width, frmsize.discrete.height));
+				frmsize.index++;
+			}
+			
+			fmtdesc.index++;
+		}
+	}
+	bool _isSupported(const FrameFormat& format) const {
+		if(_formats.empty()) // Not enumerated yet : the driver will say
+			return true;
+		
+		auto itFormat = _formats.find(static_cast<uint32_t>(format.format));
+		if(itFormat == _formats.end())
+			return false;
+		
+		const std::vector<Gb::Size>& sizes(itFormat->second);
+		if(sizes.empty())
+			return true;
+		
+		for(const Gb::Size& size : sizes) {
+			if(size.width == format.width && size.height == format.height)
+				return true;
+		}
+		return false;
+	}
+	
 	bool _initMmap() {
 		// Init buffers
 		struct v4l2_requestbuffers req = {0};
-		req.count 	= 1;
+		req.count 	= _BUFFER_COUNT;
 		req.type 	= V4L2_BUF_TYPE_VIDEO_CAPTURE;
 		req.memory 	= V4L2_MEMORY_MMAP;
 	 
-		if (_xioctl(_fd, VIDIOC_REQBUFS, &req) == -1) {
+		if (_xioctl(_fd, VIDIOC_REQBUFS, &req) == -1 || req.count < 1) {
 			_perror("Requesting Buffer");
 			return false;
 		}
 	 
-		struct v4l2_buffer buf = {0};
-		buf.type 	= V4L2_BUF_TYPE_VIDEO_CAPTURE;
-		buf.memory 	= V4L2_MEMORY_MMAP;
-		buf.index 	= 0;
+		for(uint32_t index = 0; index < req.count; index++) {
+			struct v4l2_buffer buf = {0};
+			buf.type 	= V4L2_BUF_TYPE_VIDEO_CAPTURE;
+			buf.memory 	= V4L2_MEMORY_MMAP;
+			buf.index 	= index;
+			
+			if(-1 == _xioctl(_fd, VIDIOC_QUERYBUF, &buf)) {
+				_perror("Querying Buffer");
+				return false;
+			}
+		 
+			// Memory map
+			FrameBuffer buffer;
+			buffer.start 	= mmap(NULL, buf.length, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, buf.m.offset);
+			buffer.length 	= buf.length;
+			if(buffer.start == MAP_FAILED) {
+				_perror("Mapping");
+				return false;    
+			}
+			_buffers.push_back(buffer);
+		}
 		
-		if(-1 == _xioctl(_fd, VIDIOC_QUERYBUF, &buf)) {
-			_perror("Querying Buffer");
-			return false;
+		return true;		
+	}
+	bool _releaseMmap() {
+		bool success = true;
+		for(const FrameBuffer& buffer : _buffers) {
+			if(munmap(buffer.start, buffer.length) == -1) {
+				_perror("Memory unmap");
+				success = false;
+			}
 		}
-	 
-		// Memory map
-		_buffer.start 		= mmap(NULL, buf.length, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, buf.m.offset);
-		_buffer.length 	= buf.bytesused > 0 ? buf.bytesused : buf.length;
-		if(_buffer.start == MAP_FAILED) {
-			_perror("Mapping");
-			return false;    
+		_buffers.clear();
+		_buffer = {(void*)nullptr, (size_t)0};
+		
+		// Free them in the driver : needed before a new format
+		struct v4l2_requestbuffers req = {0};
+		req.count 	= 0;
+		req.type 	= V4L2_BUF_TYPE_VIDEO_CAPTURE;
+		req.memory 	= V4L2_MEMORY_MMAP;
+		if(_xioctl(_fd, VIDIOC_REQBUFS, &req) == -1) {
+			_perror("Releasing Buffer");
+			success = false;
 		}
-		printf("Length: %d\n", _buffer.length);
 		
+		return success;
+	}
+	bool _startCapture() {
+		for(uint32_t index = 0; index < _buffers.size(); index++) {
+			if(!_askFrame(index))
+				return false;
+		}
+		_iBuffer = -1;
+		_hasSequence = false;
 		
-		// Start capture
-		if(!_askFrame())
-			return false;
-	 
-		if(_xioctl(_fd, VIDIOC_STREAMON, &buf.type) == -1) {
+		enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+		if(_xioctl(_fd, VIDIOC_STREAMON, &type) == -1) {
 			_perror("Start Capture");
 			return false;
 		}
+		return true;
+	}
+	bool _stopCapture() {
+		_iBuffer = -1; // Every buffer is dequeued
+		
+		enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+		if(_xioctl(_fd, VIDIOC_STREAMOFF, &type) == -1) {
+			_perror("Stop Capture");
+			return false;
+		}
+		return true;
+	}
+	// New format on the opened device : no reopen, no enumeration
+	bool _reconfigure() {
+		if(!_stopCapture() || !_releaseMmap())
+			return false;
 		
-		return true;		
+		return _initDevice() && _initMmap() && _startCapture();
+	}
+	
+	// Frame interval. Most drivers refuse it while streaming (EBUSY) : stop, change, restart.
+	bool _applyFrameRate(bool streaming) {
+		struct v4l2_streamparm parm = {0};
+		parm.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+		
+		if(_xioctl(_fd, VIDIOC_G_PARM, &parm) == -1 || !(parm.parm.capture.capability & V4L2_CAP_TIMEPERFRAME)) {
+			_perror("Frame Rate not supported");
+			return false;
+		}
+		
+		parm.parm.capture.timeperframe.numerator 	= 1000;
+		parm.parm.capture.timeperframe.denominator = static_cast<uint32_t>(_frameRate * 1000 + 0.5);
+		
+		if(_xioctl(_fd, VIDIOC_S_PARM, &parm) == -1) {
+			if(!streaming || errno != EBUSY) {
+				_perror("Setting Frame Rate");
+				return false;
+			}
+			
+			if(!_stopCapture())
+				return false;
+			
+			bool changed = (_xioctl(_fd, VIDIOC_S_PARM, &parm) != -1);
+			if(!changed)
+				_perror("Setting Frame Rate");
+			
+			if(!_startCapture())
+				return false;
+			
+			if(!changed)
+				return false;
+		}
+		
+		_updateFramePeriod();
+		return true;
+	}
+	void _updateFramePeriod() {
+		struct v4l2_streamparm parm = {0};
+		parm.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+		if(_xioctl(_fd, VIDIOC_G_PARM, &parm) == 0 && parm.parm.capture.timeperframe.denominator > 0)
+			_framePeriodMus = static_cast<uint32_t>(1000000ULL * parm.parm.capture.timeperframe.numerator / parm.parm.capture.timeperframe.denominator);
+	}
+	
+	// 1 : frame grabbed, 0 : nothing ready (or only corrupted frames), -1 : error
+	int _dequeue() {
+		struct v4l2_buffer buf = {0};
+		buf.type 	= V4L2_BUF_TYPE_VIDEO_CAPTURE;
+		buf.memory 	= V4L2_MEMORY_MMAP;
+		
+		for(;;) {
+			if(_xioctl(_fd, VIDIOC_DQBUF, &buf) == -1) {
+				if(EAGAIN == errno)
+					return 0;
+					
+				_perror("Grab Frame");
+				return -1;
+			}
+			
+			if(buf.index >= _buffers.size()) {
+				_perror("Unknown Buffer");
+				return -1;
+			}
+			
+			_dequeued = Timer::monotonicMus();
+			
+			// Frames skipped by the driver, the stream restarts at 0
+			if(_hasSequence && buf.sequence > _sequence + 1)
+				_nDropped += buf.sequence - _sequence - 1;
+			_sequence 	 = buf.sequence;
+			_hasSequence = true;
+			
+			// Check size
+			_iBuffer 		= static_cast<int>(buf.index);
+			_buffer.start 	= _buffers[buf.index].start;
+			_buffer.length 	= (buf.bytesused > 0) ? buf.bytesused : _buffers[buf.index].length;	
+			_nGrabbed++;
+			
+			// Check content
+			if(!_checkFrame()) {
+				_nRejected++;
+				
+				_iBuffer = -1;
+				if(!_askFrame(buf.index))
+					return -1;
+				continue;
+			}
+			
+			// Time of the exposure
+			_timestamp = _frameTimestamp(buf);
+			return 1;
+		}
 	}
-	bool _askFrame() {
+	bool _askFrame(uint32_t index) {
 		struct v4l2_buffer buf = {0};
 		buf.type 	= V4L2_BUF_TYPE_VIDEO_CAPTURE;
 		buf.memory 	= V4L2_MEMORY_MMAP;
+		buf.index 	= index;
 		
 		if(_xioctl(_fd, VIDIOC_QBUF, &buf) == -1) {
 			_perror("Query Buffer");
@@ -347,25 +612,178 @@ private:
 		return true;	
 	}
 	
+	// Mjpeg : reject truncated or corrupted frames, remove padding after EOI
+	bool _checkFrame() {
+		if(_format.format != V4L2_PIX_FMT_MJPEG)
+			return true;
+		
+		size_t validLength = 0;
+		MjpegScanner::Status status = MjpegScanner::check(reinterpret_cast<const unsigned char*>(_buffer.start), _buffer.length, validLength);
+		if(status != MjpegScanner::Valid)
+			return false;
+		
+		if(validLength < _buffer.length) {
+			_buffer.length = validLength;
+			_nTrimmed++;
+		}
+		return true;
+	}
+	
+	// Start of exposure on the monotonic clock
+	uint64_t _frameTimestamp(const struct v4l2_buffer& buf) const {
+		uint64_t timestamp = 0;
+		
+		if((buf.flags & V4L2_BUF_FLAG_TIMESTAMP_MASK) == V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC)
+			timestamp = static_cast<uint64_t>(buf.timestamp.tv_sec) * 1000000 + static_cast<uint64_t>(buf.timestamp.tv_usec);
+		else
+			timestamp = Timer::monotonicMus(); // Driver without timestamps : best effort
+		
+		// Stamped at the end of the frame : go back to its beginning
+		if((buf.flags & V4L2_BUF_FLAG_TSTAMP_SRC_MASK) == V4L2_BUF_FLAG_TSTAMP_SRC_EOF) {
+			uint32_t duration = _exposureDuration();
+			timestamp = timestamp > duration ? timestamp - duration : 0;
+		}
+		
+		return timestamp;
+	}
+	
+	// Manual exposure if known, else the frame period is the upper bound
+	uint32_t _exposureDuration() const {
+		return _exposureMus > 0 ? _exposureMus : _framePeriodMus;
+	}
+	
 	bool _treat(Gb::Frame& frame) {
 		frame = _rawData.clone();
 		return !frame.empty();
 	}
 	
-	int _isControl(int control, struct v4l2_queryctrl* queryctrl) {
-		int err = 0;
-		queryctrl->id = control;
-		if ((err = ioctl(_fd, VIDIOC_QUERYCTRL, queryctrl)) < 0)
-			printf("ioctl querycontrol error %d \n", errno);
-		else if (queryctrl->flags & V4L2_CTRL_FLAG_DISABLED)
-			printf("control %s disabled \n", (char*) queryctrl->name);
-		else if (queryctrl->flags & V4L2_CTRL_TYPE_BOOLEAN)
-			return 1;
-		else if (queryctrl->type & V4L2_CTRL_TYPE_INTEGER)
-			return 0;
-		else
-			printf("contol %s unsupported  \n", (char*) queryctrl->name);
-		return -1;
+	// -- Controls
+	static uint32_t _controlId(Device::Param code) {
+		switch(code & ~(Minimum | Maximum | Default)) {
+			case Saturation: 			return V4L2_CID_SATURATION;
+			case Exposure: 			return V4L2_CID_EXPOSURE_ABSOLUTE;
+			case AutoExposure: 		return V4L2_CID_EXPOSURE_AUTO;
+			case Gain: 				return V4L2_CID_GAIN;
+			case Brightness: 			return V4L2_CID_BRIGHTNESS;
+			case WhiteBalance: 		return V4L2_CID_WHITE_BALANCE_TEMPERATURE;
+			case AutoWhiteBalance: 	return V4L2_CID_AUTO_WHITE_BALANCE;
+			case Focus: 				return V4L2_CID_FOCUS_ABSOLUTE;
+			case AutoFocus: 			return V4L2_CID_FOCUS_AUTO;
+		}
+		return 0;
+	}
+	// Automatic mode ruling a manual control
+	static uint32_t _modeId(uint32_t id) {
+		switch(id) {
+			case V4L2_CID_EXPOSURE_ABSOLUTE: 				return V4L2_CID_EXPOSURE_AUTO;
+			case V4L2_CID_WHITE_BALANCE_TEMPERATURE: 	return V4L2_CID_AUTO_WHITE_BALANCE;
+			case V4L2_CID_FOCUS_ABSOLUTE: 				return V4L2_CID_FOCUS_AUTO;
+		}
+		return 0;
+	}
+	static int32_t _manualValue(uint32_t modeId) {
+		return modeId == V4L2_CID_EXPOSURE_AUTO ? V4L2_EXPOSURE_MANUAL : 0;
+	}
+	static int32_t _modeValue(const _Control& control, bool automatic) {
+		if(control.id != V4L2_CID_EXPOSURE_AUTO)
+			return automatic ? 1 : 0;
+		
+		if(!automatic)
+			return V4L2_EXPOSURE_MANUAL;
+		
+		// Usb cameras often only have the aperture priority mode
+		return (control.menuMask & (1ULL << V4L2_EXPOSURE_AUTO)) ? V4L2_EXPOSURE_AUTO : V4L2_EXPOSURE_APERTURE_PRIORITY;
+	}
+	
+	// Read once at open : no query at each set/get
+	void _enumControls() {
+		_controls.clear();
+		_modes.clear();
+		
+		struct v4l2_queryctrl query = {0};
+		query.id = V4L2_CTRL_FLAG_NEXT_CTRL;
+		while(_xioctl(_fd, VIDIOC_QUERYCTRL, &query) == 0) {
+			_addControl(query);
+			query.id |= V4L2_CTRL_FLAG_NEXT_CTRL;
+		}
+		
+		// Old drivers : no NEXT_CTRL
+		if(_controls.empty()) {
+			for(uint32_t id = V4L2_CID_BASE; id < V4L2_CID_LASTP1; id++)
+				_queryControl(id);
+			for(uint32_t id = V4L2_CID_CAMERA_CLASS_BASE; id < V4L2_CID_CAMERA_CLASS_BASE + 64; id++)
+				_queryControl(id);
+		}
+		
+		// Current modes
+		const uint32_t modes[] = {V4L2_CID_EXPOSURE_AUTO, V4L2_CID_AUTO_WHITE_BALANCE, V4L2_CID_FOCUS_AUTO};
+		for(uint32_t modeId : modes) {
+			if(_controls.find(modeId) == _controls.end())
+				continue;
+			
+			struct v4l2_control current = {0};
+			current.id = modeId;
+			if(_xioctl(_fd, VIDIOC_G_CTRL, &current) == 0)
+				_modes[modeId] = current.value;
+		}
+	}
+	void _queryControl(uint32_t id) {
+		struct v4l2_queryctrl query = {0};
+		query.id = id;
+		if(_xioctl(_fd, VIDIOC_QUERYCTRL, &query) == 0)
+			_addControl(query);
+	}
+	void _addControl(const struct v4l2_queryctrl& query) {
+		if((query.flags & V4L2_CTRL_FLAG_DISABLED) || query.type == V4L2_CTRL_TYPE_CTRL_CLASS)
+			return;
+		
+		_Control control = {0};
+		control.id 			= query.id;
+		control.type 			= query.type;
+		control.minimum 		= query.minimum;
+		control.maximum 		= query.maximum;
+		control.step 			= query.step;
+		control.defaultValue	= query.default_value;
+		control.flags 		= query.flags;
+		
+		// Valid entries of the menus
+		if(query.type == V4L2_CTRL_TYPE_MENU) {
+			for(int32_t index = std::max(query.minimum, 0); index <= query.maximum && index < 64; index++) {
+				struct v4l2_querymenu menu = {0};
+				menu.id 	= query.id;
+				menu.index = index;
+				if(_xioctl(_fd, VIDIOC_QUERYMENU, &menu) == 0)
+					control.menuMask |= (1ULL << index);
+			}
+		}
+		
+		_controls[control.id] = control;
+	}
+	
+	bool _applyControls(std::vector<struct v4l2_ext_control>& controls) {
+		if(controls.empty())
+			return true;
+		
+		struct v4l2_ext_controls ext = {0};
+		ext.ctrl_class 	= 0; // Any class
+		ext.count 		= static_cast<uint32_t>(controls.size());
+		ext.controls 		= controls.data();
+		
+		if(_xioctl(_fd, VIDIOC_S_EXT_CTRLS, &ext) == 0)
+			return true;
+		
+		// Drivers refusing mixed classes or extended controls : one by one
+		for(const struct v4l2_ext_control& extControl : controls) {
+			struct v4l2_control control = {0};
+			control.id 	= extControl.id;
+			control.value = extControl.value;
+			
+			if(_xioctl(_fd, VIDIOC_S_CTRL, &control) == -1) {
+				_perror("Setting Control");
+				return false;
+			}
+		}
+		return true;
 	}
 	
 	void _perror(const std::string& message) const {
@@ -377,8 +795,28 @@ private:
 	int _fd;
 	std::string _path;
 	FrameFormat	_format;
-	FrameBuffer _buffer;
+	std::vector<FrameBuffer> _buffers;	// Mapped, full length
+	FrameBuffer _buffer;				// Grabbed : data and bytes used
+	int _iBuffer;						// Index of the grabbed buffer, -1 : none
+	std::map<uint32_t, std::vector<Gb::Size>> _formats; // Enumerated once : discrete sizes by pixel format
 	Gb::Frame 	_rawData;
+	
+	uint64_t _timestamp;		// Last frame grabbed (mus)
+	uint64_t _dequeued;
+	uint32_t _sequence;
+	bool _hasSequence;
+	uint32_t _exposureMus;		// Manual exposure, 0 in automatic mode
+	uint32_t _framePeriodMus;
+	double _frameRate;			// Asked by the user, 0 : driver default
+	
+	std::map<uint32_t, _Control> _controls;
+	std::map<uint32_t, int32_t> _modes;	// Automatic modes, as set
+	
+	// Statistics, read from other threads
+	std::atomic<uint64_t> _nGrabbed 	= {0};
+	std::atomic<uint64_t> _nRejected = {0};
+	std::atomic<uint64_t> _nTrimmed 	= {0};
+	std::atomic<uint64_t> _nDropped 	= {0};
 };
 
 #endif
\ No newline at end of file
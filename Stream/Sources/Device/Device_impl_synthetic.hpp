@@ -0,0 +1,179 @@
+#pragma once
+
+#include "Device_backend.hpp"
+#include "../Timer.hpp"
+
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <algorithm>
+
+// ------------ Generated frames, no camera needed ------------
+// Path : "synthetic:640x480?fps=30&format=mjpg&bytes=40000". fps=0 : as fast as possible.
+// Mjpeg frames only have a jpeg structure (SOI, SOS, EOI) around filler data : they are not decodable.
+struct Device::_ImplSynthetic : public Device::_Backend {
+public:
+	// Constructors
+	explicit _ImplSynthetic(const std::string& size, const std::string& query) :
+		_format({640, 480, MJPG}),
+		_bytes(static_cast<size_t>(DeviceBackend::option(query, "bytes", 0.0))),
+		_opened(false),
+		_counter(0),
+		_timestamp(0)
+	{
+		int width = 0, height = 0;
+		if(sscanf(size.c_str(), "%dx%d", &width, &height) == 2 && width > 0 && height > 0) {
+			_format.width  = width;
+			_format.height = height;
+		}
+		if(DeviceBackend::option(query, "format", "mjpg") == "yuyv")
+			_format.format = YUYV;
+
+		_pacer.setFrameRate(DeviceBackend::option(query, "fps", 30.0));
+	}
+
+	// Methods
+	bool open() {
+		_opened = true;
+		_generate();
+		return true;
+	}
+	bool close() {
+		_opened = false;
+		_pattern.clear();
+		return true;
+	}
+
+	bool grab() {
+		if(!_opened)
+			return false;
+
+		_pacer.wait();
+		_next();
+
+		return true;
+	}
+	bool tryGrab() {
+		if(!_opened || !_pacer.poll())
+			return false;
+
+		_next();
+		return true;
+	}
+	bool retrieve(Gb::Frame& frame) {
+		if(!_opened || _pattern.empty())
+			return false;
+
+		frame = Gb::Frame(&_pattern[0], _pattern.size(), Gb::Size(_format.width, _format.height));
+		frame.timestamp = _timestamp;
+		frame.dequeued 	= _timestamp;
+		frame.sequence 	= static_cast<uint32_t>(_counter);
+
+		// Content changes with every frame
+		const size_t offset = (_format.format == MJPG) ? _HEADER_SIZE : 0;
+		const size_t span = frame.buffer.size() - offset - (_format.format == MJPG ? 2 : 0);
+		if(span > 0)
+			frame.buffer[offset + (_counter * 4099) % span] = static_cast<unsigned char>(_counter % 0xFF);
+
+		return !frame.empty();
+	}
+	bool read(Gb::Frame& frame) {
+		return (grab() && retrieve(frame));
+	}
+
+	// Setters
+	bool setFormat(int width, int height, PixelFormat formatPix) {
+		if(width <= 0 || height <= 0)
+			return false;
+
+		_format.width  = width;
+		_format.height = height;
+		_format.format = formatPix;
+
+		if(_opened)
+			_generate();
+		return true;
+	}
+	bool setFrameRate(double fps) {
+		_pacer.setFrameRate(fps);
+		return true;
+	}
+	bool set(Device::Param, double) {
+		return false;
+	}
+	bool set(const ParamList&) {
+		return false;
+	}
+
+	// Getters
+	const FrameFormat getFormat() const {
+		return _format;
+	}
+	double getFrameRate() {
+		return _pacer.frameRate();
+	}
+	const CaptureStats getCaptureStats() const {
+		return _stats;
+	}
+	double get(Device::Param) {
+		return 0.0;
+	}
+	int fd() {
+		return _pacer.fd();
+	}
+
+private:
+	// SOI + SOS segment (length 8)
+	static const size_t _HEADER_SIZE = 2 + 10;
+
+	// Methods
+	void _next() {
+		_counter++;
+		_timestamp = Timer::monotonicMus();
+		_stats.grabbed++;
+	}
+	void _generate() {
+		if(_format.format == YUYV) {
+			// Gradient of luma, neutral chroma
+			_pattern.resize(static_cast<size_t>(_format.width) * _format.height * 2);
+			for(int y = 0; y < _format.height; y++) {
+				unsigned char* row = &_pattern[static_cast<size_t>(y) * _format.width * 2];
+				for(int x = 0; x < _format.width; x++) {
+					row[2*x]   = static_cast<unsigned char>((x + y) & 0xFF);
+					row[2*x+1] = 128;
+				}
+			}
+			return;
+		}
+
+		// Mjpeg : default size close to a 640x480 frame of an usb camera
+		size_t total = _bytes > 0 ? _bytes : static_cast<size_t>(_format.width) * _format.height / 8;
+		total = std::max(total, _HEADER_SIZE + 3);
+
+		const unsigned char header[_HEADER_SIZE] = {
+			0xFF, 0xD8,											// SOI
+			0xFF, 0xDA, 0x00, 0x08, 0x01, 0x01, 0x00, 0x00, 0x3F, 0x00	// SOS
+		};
+
+		_pattern.resize(total);
+		std::copy(header, header + _HEADER_SIZE, _pattern.begin());
+
+		// Filler without any 0xFF : no marker inside the scan
+		for(size_t i = _HEADER_SIZE; i < total - 2; i++)
+			_pattern[i] = static_cast<unsigned char>((i * 131) % 0xFF);
+
+		_pattern[total-2] = 0xFF;	// EOI
+		_pattern[total-1] = 0xD9;
+	}
+
+	// Members
+	FrameFormat _format;
+	size_t _bytes;
+	bool _opened;
+	CaptureStats _stats;
+	DeviceBackend::Pacer _pacer;
+
+	std::vector<unsigned char> _pattern;
+	uint64_t _counter;
+	uint64_t _timestamp;
+};
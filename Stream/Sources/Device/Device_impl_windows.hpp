@@ -1,7 +1,8 @@
 #pragma once
 #ifdef _WIN32
 
-#include "Device.hpp"
+#include "Device_backend.hpp"
+#include "../Timer.hpp"
 
 // Based on Opencv
 #include <opencv2/core.hpp>	
@@ -11,12 +12,14 @@
 #include <opencv2/imgcodecs.hpp>
 
 
-struct Device::_Impl {
+struct Device::_Impl : public Device::_Backend {
 public:
 	// Constructors
 	explicit _Impl(const std::string& pathVideo) : 
 		_path(pathVideo), 
 		_format({0, 0, MJPG}),
+		_timestamp(0),
+		_frameRate(0.0),
 		_PARAMS({(int)cv::IMWRITE_JPEG_QUALITY, 40}) {
 		// Wait for open
 	}
@@ -36,6 +39,8 @@ public:
 		if(_format.width > 0 && _format.height > 0) {
 			setFormat(_format.width, _format.height, (PixelFormat)_format.format);
 		}
+		if(_frameRate > 0)
+			_cap.set(cv::CAP_PROP_FPS, _frameRate);
 		
 		return _cap.isOpened();
 	}
@@ -47,7 +52,15 @@ public:
 	}
 	
 	bool grab() {
-		return _cap.grab();
+		if(!_cap.grab())
+			return false;
+		
+		_stats.grabbed++;
+		_timestamp = Timer::monotonicMus(); // No driver timestamp here
+		return true;
+	}
+	bool tryGrab() {
+		return grab(); // No descriptor to wait on : blocking
 	}
 	bool retrieve(Gb::Frame& frame) {
 		cv::Mat cvFrame;
@@ -63,6 +76,10 @@ public:
 		
 		// Complete
 		frame.size = Gb::Size(_format.width, _format.height);
+		frame.timestamp = _timestamp;
+		frame.dequeued 	= _timestamp;
+		frame.sequence 	= static_cast<uint32_t>(_stats.grabbed);
+		frame.exposure  = 0;
 		return frame.size.area() > 0;
 	}
 	bool read(Gb::Frame& frame) {
@@ -81,6 +98,13 @@ public:
 		
 		return true;
 	}
+	bool setFrameRate(double fps) {
+		if(fps <= 0)
+			return false;
+		
+		_frameRate = fps;
+		return !_cap.isOpened() || _cap.set(cv::CAP_PROP_FPS, fps);
+	}
 	bool set(Device::Param code, double value) {		
 		switch(code) {
 			case Saturation:
@@ -89,10 +113,29 @@ public:
 				return _cap.set(cv::CAP_PROP_EXPOSURE, value);
 			case AutoExposure:
 				return _cap.set(cv::CAP_PROP_AUTO_EXPOSURE, value != 0 ? 1 : 0);
+			case Gain:
+				return _cap.set(cv::CAP_PROP_GAIN, value);
+			case Brightness:
+				return _cap.set(cv::CAP_PROP_BRIGHTNESS, value);
+			case WhiteBalance:
+				return _cap.set(cv::CAP_PROP_WB_TEMPERATURE, value);
+			case AutoWhiteBalance:
+				return _cap.set(cv::CAP_PROP_AUTO_WB, value != 0 ? 1 : 0);
+			case Focus:
+				return _cap.set(cv::CAP_PROP_FOCUS, value);
+			case AutoFocus:
+				return _cap.set(cv::CAP_PROP_AUTOFOCUS, value != 0 ? 1 : 0);
 		}
 		
 		return false;
 	}
+	bool set(const ParamList& params) {
+		bool success = true;
+		for(const auto& param : params)
+			success = set(param.first, param.second) && success;
+		
+		return success;
+	}
 	
 	// Getters
 	double get(Device::Param code) {
@@ -120,6 +163,20 @@ public:
 			// Auto
 			case AutoExposure:
 				return _cap.get(cv::CAP_PROP_AUTO_EXPOSURE);
+				
+			// Others : no limits known
+			case Gain:
+				return _cap.get(cv::CAP_PROP_GAIN);
+			case Brightness:
+				return _cap.get(cv::CAP_PROP_BRIGHTNESS);
+			case WhiteBalance:
+				return _cap.get(cv::CAP_PROP_WB_TEMPERATURE);
+			case AutoWhiteBalance:
+				return _cap.get(cv::CAP_PROP_AUTO_WB);
+			case Focus:
+				return _cap.get(cv::CAP_PROP_FOCUS);
+			case AutoFocus:
+				return _cap.get(cv::CAP_PROP_AUTOFOCUS);
 		}
 		
 		return 0.0;
@@ -128,12 +185,24 @@ public:
 	const FrameFormat getFormat() const {
 		return _format;
 	}
+	int fd() {
+		return -1;
+	}
+	double getFrameRate() {
+		return _cap.get(cv::CAP_PROP_FPS);
+	}
+	const CaptureStats getCaptureStats() const {
+		return _stats; // Frames are encoded here : never corrupted
+	}
 	
 private:
 	// Members
 	std::string _path;
 	cv::VideoCapture _cap;
 	FrameFormat	_format;
+	uint64_t _timestamp;
+	CaptureStats _stats;
+	double _frameRate;
 	
 	// Constantes
 	const std::vector<int> _PARAMS;
@@ -0,0 +1,257 @@
+#pragma once
+
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <deque>
+#include <map>
+#include <memory>
+#include <functional>
+
+#include "structures.hpp"
+
+// ------------ FrameHub : Fan-out frames to subscribers, each one in its own thread ------------
+class FrameHub {
+public:
+	// Enums
+	enum DropPolicy {
+		DropOldest,	// Queue full : forget the oldest queued frame
+		DropNewest,	// Queue full : forget the incoming frame
+		LatestOnly	// Only keep the last frame published
+	};
+
+	// Structures
+	struct Options {
+		Options(size_t capacity_ = 4, DropPolicy policy_ = DropOldest, double maxFps_ = 0.0) :
+			capacity(capacity_), policy(policy_), maxFps(maxFps_)
+		{
+		}
+
+		size_t capacity;		// Maximum frames waiting in the queue
+		DropPolicy policy;
+		double maxFps;		// 0 : no limit
+	};
+
+	struct Stats {
+		uint64_t published 	= 0; // Frames offered to the subscriber
+		uint64_t delivered 	= 0; // Frames given to the callback
+		uint64_t dropped 		= 0; // Frames lost because the queue was full
+		uint64_t limited 		= 0; // Frames skipped by the rate limit
+		size_t queued 			= 0; // Frames waiting right now
+		int64_t lagMus 		= 0; // Time spent in the queue by the last delivered frame
+	};
+
+	typedef std::shared_ptr<const Gb::Frame> FramePtr;
+	typedef std::function<void(const Gb::Frame&)> Callback;
+
+private:
+	typedef std::chrono::steady_clock _Clock;
+
+	struct _Item {
+		FramePtr frame;
+		_Clock::time_point tPush;
+	};
+
+	struct _Subscriber {
+		_Subscriber(const Callback& cbk, const Options& opt) :
+			options(opt), cbkFrame(cbk), running(true)
+		{
+			if(options.capacity == 0 || options.policy == LatestOnly)
+				options.capacity = 1;
+		}
+
+		Options options;
+		Callback cbkFrame;
+
+		std::mutex mutQueue;
+		std::condition_variable cvQueue;
+		std::deque<_Item> queue;
+		_Clock::time_point tLastAccepted;
+		bool hasAccepted = false;
+
+		Stats stats; // Protected by mutQueue
+
+		std::atomic<bool> running;
+		std::shared_ptr<std::thread> pThread;
+	};
+
+public:
+	// Constructor
+	FrameHub() : _nextId(0) {
+		// Wait for subscribers
+	}
+
+	// Destructor
+	~FrameHub() {
+		clear();
+	}
+
+	// - Methods
+	// Add a subscriber, return its id
+	int subscribe(const Callback& cbkFrame, const Options& options = Options()) {
+		std::shared_ptr<_Subscriber> sub = std::make_shared<_Subscriber>(cbkFrame, options);
+		sub->pThread = std::make_shared<std::thread>(&FrameHub::_deliver, sub);
+
+		std::lock_guard<std::mutex> lockSubs(_mutSubs);
+		int id = _nextId++;
+		_subscribers[id] = sub;
+
+		return id;
+	}
+
+	// Remove a subscriber, wait for its callback to end
+	bool unsubscribe(int id) {
+		std::shared_ptr<_Subscriber> sub;
+		{
+			std::lock_guard<std::mutex> lockSubs(_mutSubs);
+			auto it = _subscribers.find(id);
+			if(it == _subscribers.end())
+				return false;
+
+			sub = it->second;
+			_subscribers.erase(it);
+		}
+
+		_stop(sub);
+		return true;
+	}
+
+	// Remove all subscribers
+	void clear() {
+		std::map<int, std::shared_ptr<_Subscriber>> subscribers;
+		{
+			std::lock_guard<std::mutex> lockSubs(_mutSubs);
+			subscribers.swap(_subscribers);
+		}
+
+		for(auto& sub : subscribers)
+			_stop(sub.second);
+	}
+
+	// Give the frame to every subscriber. Only one copy is made, whatever the number of subscribers.
+	void publish(const Gb::Frame& frame) {
+		if(empty())
+			return;
+
+		publish(std::make_shared<const Gb::Frame>(frame));
+	}
+	void publish(const FramePtr& pFrame) {
+		const _Clock::time_point now = _Clock::now();
+
+		std::lock_guard<std::mutex> lockSubs(_mutSubs);
+		for(auto& it : _subscribers)
+			_push(*it.second, pFrame, now);
+	}
+
+	// Getters
+	bool empty() const {
+		std::lock_guard<std::mutex> lockSubs(_mutSubs);
+		return _subscribers.empty();
+	}
+	size_t count() const {
+		std::lock_guard<std::mutex> lockSubs(_mutSubs);
+		return _subscribers.size();
+	}
+	bool getStats(int id, Stats& stats) const {
+		std::shared_ptr<_Subscriber> sub;
+		{
+			std::lock_guard<std::mutex> lockSubs(_mutSubs);
+			auto it = _subscribers.find(id);
+			if(it == _subscribers.end())
+				return false;
+
+			sub = it->second;
+		}
+
+		std::lock_guard<std::mutex> lockQueue(sub->mutQueue);
+		stats = sub->stats;
+		stats.queued = sub->queue.size();
+		return true;
+	}
+
+private:
+	// Statics
+	static void _push(_Subscriber& sub, const FramePtr& pFrame, const _Clock::time_point& now) {
+		std::unique_lock<std::mutex> lockQueue(sub.mutQueue);
+		sub.stats.published++;
+
+		// Rate limit
+		if(sub.options.maxFps > 0 && sub.hasAccepted) {
+			const auto period = std::chrono::duration<double>(1.0 / sub.options.maxFps);
+			if(now - sub.tLastAccepted < period) {
+				sub.stats.limited++;
+				return;
+			}
+		}
+		sub.tLastAccepted = now;
+		sub.hasAccepted = true;
+
+		// Room left ?
+		if(sub.queue.size() >= sub.options.capacity) {
+			sub.stats.dropped++;
+
+			if(sub.options.policy == DropNewest)
+				return;
+
+			sub.queue.pop_front(); // DropOldest or LatestOnly
+		}
+
+		sub.queue.push_back(_Item{pFrame, now});
+		lockQueue.unlock();
+
+		sub.cvQueue.notify_one();
+	}
+
+	// Threaded function : wait frames and call back
+	static void _deliver(std::shared_ptr<_Subscriber> pSub) {
+		_Subscriber& sub(*pSub);
+
+		for(;;) {
+			_Item item;
+			{
+				std::unique_lock<std::mutex> lockQueue(sub.mutQueue);
+				sub.cvQueue.wait(lockQueue, [&sub]() {
+					return !sub.running || !sub.queue.empty();
+				});
+
+				if(!sub.running)
+					break;
+
+				item = sub.queue.front();
+				sub.queue.pop_front();
+
+				sub.stats.delivered++;
+				sub.stats.lagMus = std::chrono::duration_cast<std::chrono::microseconds>(_Clock::now() - item.tPush).count();
+			}
+
+			if(sub.cbkFrame)
+				sub.cbkFrame(*item.frame);
+		}
+	}
+
+	static void _stop(const std::shared_ptr<_Subscriber>& pSub) {
+		{
+			std::lock_guard<std::mutex> lockQueue(pSub->mutQueue);
+			pSub->running = false;
+		}
+		pSub->cvQueue.notify_all();
+
+		if(pSub->pThread && pSub->pThread->joinable()) {
+			// A callback unsubscribing itself can't join its own thread
+			if(pSub->pThread->get_id() == std::this_thread::get_id())
+				pSub->pThread->detach();
+			else
+				pSub->pThread->join();
+		}
+
+		pSub->pThread.reset();
+	}
+
+	// Members
+	int _nextId;
+
+	mutable std::mutex _mutSubs;
+	std::map<int, std::shared_ptr<_Subscriber>> _subscribers;
+};
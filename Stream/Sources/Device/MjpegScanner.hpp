@@ -0,0 +1,147 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+
+// ------------ MjpegScanner : Check a jpeg structure without decoding it ------------
+// Walk the segments headers, then search the entropy coded data for markers with memchr.
+class MjpegScanner {
+public:
+	enum Status {
+		Valid,
+		NoStart,		// SOI missing
+		BadSegment,		// Segment length or marker impossible
+		NoScan,			// EOI before any SOS
+		Truncated		// EOI missing
+	};
+
+	// Return Valid and the length up to EOI (trailing padding removed) if the frame is usable
+	static Status check(const unsigned char* data, const size_t len, size_t& validLength) {
+		validLength = 0;
+
+		if(data == nullptr || len < 4 || data[0] != 0xFF || data[1] != SOI)
+			return NoStart;
+
+		size_t pos = 2;
+		bool scan = false;
+
+		while(pos < len) {
+			// -- Segments : [FF][marker][length 2 bytes][...]
+			if(!scan) {
+				if(data[pos] != 0xFF)
+					return BadSegment;
+
+				// Fill bytes
+				while(pos + 1 < len && data[pos+1] == 0xFF)
+					pos++;
+
+				if(pos + 1 >= len)
+					return Truncated;
+
+				const unsigned char marker = data[pos+1];
+				if(marker == EOI)
+					return NoScan;
+
+				if(_isStandalone(marker)) {
+					pos += 2;
+					continue;
+				}
+
+				if(pos + 3 >= len)
+					return Truncated;
+
+				const size_t segLength = (static_cast<size_t>(data[pos+2]) << 8) | data[pos+3];
+				if(segLength < 2)
+					return BadSegment;
+
+				pos += 2 + segLength;
+				scan = (marker == SOS);
+				continue;
+			}
+
+			// -- Entropy coded data : only FF00, RSTn and fill bytes are allowed until the next marker
+			const unsigned char* pFF = static_cast<const unsigned char*>(memchr(data + pos, 0xFF, len - pos));
+			if(pFF == nullptr || pFF + 1 >= data + len)
+				return Truncated;
+
+			pos = static_cast<size_t>(pFF - data);
+			const unsigned char next = data[pos+1];
+
+			if(next == 0x00 || (next >= RST0 && next <= RST7)) {
+				pos += 2;
+			}
+			else if(next == 0xFF) {
+				pos += 1;
+			}
+			else if(next == EOI) {
+				validLength = pos + 2;
+				return Valid;
+			}
+			else {
+				scan = false; // Another segment (progressive jpeg : tables and scans)
+			}
+		}
+
+		return Truncated;
+	}
+
+	// Size written in the frame header (SOFn), false if not found
+	static bool dimensions(const unsigned char* data, const size_t len, int& width, int& height) {
+		if(data == nullptr || len < 4 || data[0] != 0xFF || data[1] != SOI)
+			return false;
+
+		size_t pos = 2;
+		while(pos + 3 < len && data[pos] == 0xFF) {
+			const unsigned char marker = data[pos+1];
+			if(marker == 0xFF) { // Fill byte
+				pos++;
+				continue;
+			}
+			if(_isStandalone(marker)) {
+				pos += 2;
+				continue;
+			}
+			if(marker == SOS || marker == EOI)
+				return false;
+
+			// SOF0..SOF15, except DHT, JPG and DAC
+			if(marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC) {
+				if(pos + 8 >= len)
+					return false;
+
+				height = (data[pos+5] << 8) | data[pos+6];
+				width  = (data[pos+7] << 8) | data[pos+8];
+				return true;
+			}
+
+			pos += 2 + ((static_cast<size_t>(data[pos+2]) << 8) | data[pos+3]);
+		}
+
+		return false;
+	}
+
+	static const char* statusStr(const Status status) {
+		switch(status) {
+			case Valid: 		return "Valid";
+			case NoStart: 		return "No start of image";
+			case BadSegment:	return "Bad segment";
+			case NoScan: 		return "No scan";
+			case Truncated: 	return "Truncated";
+		}
+		return "";
+	}
+
+private:
+	enum Marker {
+		SOI 	= 0xD8,
+		EOI 	= 0xD9,
+		SOS 	= 0xDA,
+		RST0 	= 0xD0,
+		RST7 	= 0xD7,
+		TEM 	= 0x01
+	};
+
+	static bool _isStandalone(const unsigned char marker) {
+		return marker == TEM || (marker >= RST0 && marker <= RST7);
+	}
+};
@@ -0,0 +1,184 @@
+#pragma once
+
+#include <csetjmp>
+#include <cstdlib>
+#include <vector>
+#include <mutex>
+
+#include <jpeglib.h>
+
+#include "structures.hpp"
+#include "YuyvStage.hpp"
+#include "../Timer.hpp"
+
+// ------------ MotionGate : Tell if a frame changed enough to be sent ------------
+// Mjpeg : thumbnail made of the luma DC coefficients only (libjpeg 1/8 scaling, no IDCT).
+// Yuyv  : luma decimated by 4.
+class MotionGate {
+public:
+	// Structures
+	struct Options {
+		Options(int pixelThreshold_ = 10, double changedRatio_ = 0.005, uint64_t keepAliveMus_ = 1000000) :
+			pixelThreshold(pixelThreshold_), changedRatio(changedRatio_), keepAliveMus(keepAliveMus_)
+		{
+		}
+
+		int pixelThreshold;		// Luma difference of a thumbnail pixel to be counted as changed
+		double changedRatio;		// Part of the thumbnail that must change
+		uint64_t keepAliveMus;	// A frame is sent at least this often, changed or not
+	};
+
+	struct Stats {
+		uint64_t sent		= 0;
+		uint64_t skipped	= 0;
+		double lastChange	= 0.0;	// Part of the thumbnail changed, last frame
+	};
+
+private:
+	struct _ErrorMgr {
+		struct jpeg_error_mgr pub;
+		jmp_buf jump;
+	};
+
+public:
+	// Constructor
+	explicit MotionGate(const Options& options = Options()) :
+		_options(options),
+		_tLastSent(0),
+		_luma4(4)
+	{
+		_decoder.err = jpeg_std_error(&_decoderErr.pub);
+		_decoderErr.pub.error_exit 		= &MotionGate::_onError;
+		_decoderErr.pub.output_message	= &MotionGate::_onMessage;
+		jpeg_create_decompress(&_decoder);
+	}
+	~MotionGate() {
+		jpeg_destroy_decompress(&_decoder);
+	}
+
+	// - Methods
+	// Return true if the frame must be sent
+	bool update(const Gb::Frame& frame) {
+		std::lock_guard<std::mutex> lockGate(_mutGate);
+
+		const uint64_t now = frame.timestamp > 0 ? frame.timestamp : Timer::monotonicMus();
+
+		// Frame we can't read : let the client decide
+		if(!_thumbnail(frame, _current)) {
+			_stats.sent++;
+			return true;
+		}
+
+		bool changed = (_reference.size.width != _current.size.width || _reference.size.height != _current.size.height);
+		_stats.lastChange = changed ? 1.0 : _changeRatio(_reference, _current);
+		changed = changed || _stats.lastChange >= _options.changedRatio;
+
+		bool alive = (now >= _tLastSent + _options.keepAliveMus);
+
+		if(!changed && !alive) {
+			_stats.skipped++;
+			return false;
+		}
+
+		// Compared to the last frame sent : slow drifts end up being sent too
+		_reference.buffer.swap(_current.buffer);
+		_reference.size = _current.size;
+		_tLastSent = now;
+		_stats.sent++;
+
+		return true;
+	}
+
+	void reset() {
+		std::lock_guard<std::mutex> lockGate(_mutGate);
+		_reference.clear();
+		_tLastSent = 0;
+	}
+
+	// Getters
+	const Stats getStats() const {
+		std::lock_guard<std::mutex> lockGate(_mutGate);
+		return _stats;
+	}
+
+private:
+	// Statics
+	static void _onError(j_common_ptr cinfo) {
+		_ErrorMgr* err = reinterpret_cast<_ErrorMgr*>(cinfo->err);
+		longjmp(err->jump, 1);
+	}
+	static void _onMessage(j_common_ptr) {
+		// Silent
+	}
+
+	// Methods
+	bool _thumbnail(const Gb::Frame& frame, Gb::Frame& thumbnail) {
+		if(frame.length() > 2 && frame.buffer[0] == 0xFF && frame.buffer[1] == 0xD8)
+			return _thumbnailJpeg(frame, thumbnail);
+
+		return _luma4.process(frame, thumbnail);
+	}
+
+	bool _thumbnailJpeg(const Gb::Frame& frame, Gb::Frame& thumbnail) {
+		if(setjmp(_decoderErr.jump)) {
+			jpeg_abort_decompress(&_decoder);
+			return false;
+		}
+
+		jpeg_mem_src(&_decoder, const_cast<unsigned char*>(frame.start()), frame.length());
+		if(jpeg_read_header(&_decoder, TRUE) != JPEG_HEADER_OK) {
+			jpeg_abort_decompress(&_decoder);
+			return false;
+		}
+
+		// 1/8 : one pixel per block, its DC coefficient. Luma only.
+		_decoder.scale_num 			= 1;
+		_decoder.scale_denom 		= 8;
+		_decoder.out_color_space 	= JCS_GRAYSCALE;
+		_decoder.dct_method 		= JDCT_IFAST;
+		_decoder.do_fancy_upsampling = FALSE;
+		_decoder.do_block_smoothing 	= FALSE;
+
+		jpeg_start_decompress(&_decoder);
+
+		const int width  = _decoder.output_width;
+		const int height = _decoder.output_height;
+		thumbnail.buffer.resize(static_cast<size_t>(width) * height);
+		thumbnail.size = Gb::Size(width, height);
+
+		while(_decoder.output_scanline < _decoder.output_height) {
+			JSAMPROW row = &thumbnail.buffer[static_cast<size_t>(_decoder.output_scanline) * width];
+			jpeg_read_scanlines(&_decoder, &row, 1);
+		}
+		jpeg_finish_decompress(&_decoder);
+
+		return !thumbnail.empty();
+	}
+
+	double _changeRatio(const Gb::Frame& a, const Gb::Frame& b) const {
+		const size_t total = a.buffer.size();
+		if(total == 0 || b.buffer.size() != total)
+			return 1.0;
+
+		size_t changed = 0;
+		for(size_t i = 0; i < total; i++) {
+			int diff = static_cast<int>(a.buffer[i]) - static_cast<int>(b.buffer[i]);
+			changed += (diff > _options.pixelThreshold || diff < -_options.pixelThreshold) ? 1 : 0;
+		}
+
+		return static_cast<double>(changed) / total;
+	}
+
+	// Members
+	const Options _options;
+
+	mutable std::mutex _mutGate;
+	Stats _stats;
+	uint64_t _tLastSent;
+	Gb::Frame _reference;	// Thumbnail of the last frame sent
+	Gb::Frame _current;
+
+	YuyvStage _luma4;
+	struct jpeg_decompress_struct _decoder;
+	_ErrorMgr _decoderErr;
+};
@@ -0,0 +1,184 @@
+#pragma once
+
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <functional>
+#include <algorithm>
+
+#include "DeviceMt.hpp"
+#include "../Timer.hpp"
+
+// ------------ RateController : Capture frame rate driven by load and demand ------------
+// Step down the ladder when the capture thread is too busy or the senders can't follow,
+// step up when there is headroom. Never above what the subscribers asked for.
+class RateController {
+public:
+	// Structures
+	struct Options {
+		Options(double minFps_ = 5.0, double maxFps_ = 30.0) :
+			minFps(minFps_), maxFps(maxFps_),
+			cpuHigh(0.6), cpuLow(0.3),
+			backlogHigh(2),
+			periodMs(2000)
+		{
+		}
+
+		double minFps;
+		double maxFps;
+		double cpuHigh;		// Part of a core used by the capture thread : slow down above
+		double cpuLow;		// Speed up below
+		size_t backlogHigh;	// Frames waiting or dropped by the senders in a period : slow down above
+		int periodMs;			// Time between two decisions
+	};
+
+	typedef std::function<double(void)> DemandFunction;	// Frame rate wanted, 0 : nobody is watching
+	typedef std::function<size_t(void)> BacklogFunction;	// Frames waiting or dropped since the last call
+
+public:
+	// Constructor
+	explicit RateController(DeviceMt& device, const Options& options = Options()) :
+		_device(device),
+		_options(options),
+		_fps(0.0),
+		_cpuLoad(0.0),
+		_running(false),
+		_lastCpuMus(0)
+	{
+		// Standard rates supported by most cameras
+		const double rates[] = {5.0, 7.5, 10.0, 15.0, 20.0, 25.0, 30.0, 60.0};
+		for(double rate : rates)
+			if(rate >= _options.minFps && rate <= _options.maxFps)
+				_ladder.push_back(rate);
+
+		if(_ladder.empty())
+			_ladder.push_back(_options.maxFps);
+	}
+	~RateController() {
+		stop();
+	}
+
+	// - Methods
+	void onDemand(const DemandFunction& cbkDemand) {
+		std::lock_guard<std::mutex> lockCbk(_mutCbk);
+		_cbkDemand = cbkDemand;
+	}
+	void onBacklog(const BacklogFunction& cbkBacklog) {
+		std::lock_guard<std::mutex> lockCbk(_mutCbk);
+		_cbkBacklog = cbkBacklog;
+	}
+
+	void start() {
+		if(_running)
+			return;
+
+		_running = true;
+		_pThread = std::make_shared<std::thread>(&RateController::_loop, this);
+	}
+	void stop() {
+		_running = false;
+
+		if(_pThread && _pThread->joinable())
+			_pThread->join();
+
+		_pThread.reset();
+	}
+
+	// One decision, return the frame rate applied
+	double update() {
+		// -- Inputs
+		const uint64_t cpuMus = _device.getCaptureCpuMus();
+		const int64_t wallMus = _clock.elapsed_mus();
+		_clock.beg();
+
+		if(wallMus > 0 && cpuMus >= _lastCpuMus)
+			_cpuLoad = static_cast<double>(cpuMus - _lastCpuMus) / wallMus;
+		_lastCpuMus = cpuMus;
+
+		double demand = _options.maxFps;
+		size_t backlog = 0;
+		{
+			std::lock_guard<std::mutex> lockCbk(_mutCbk);
+			if(_cbkDemand)
+				demand = _cbkDemand();
+			if(_cbkBacklog)
+				backlog = _cbkBacklog();
+		}
+
+		// -- Decision
+		if(_fps <= 0)
+			_fps = _device.getFrameRate();
+
+		size_t rung = _rungOf(_fps);
+		const size_t ceiling = demand > 0 ? _rungOf(std::min(demand, _options.maxFps)) : 0;
+
+		if(_cpuLoad > _options.cpuHigh || backlog > _options.backlogHigh) {
+			if(rung > 0)
+				rung--;
+		}
+		else if(_cpuLoad < _options.cpuLow && backlog == 0) {
+			if(rung + 1 < _ladder.size())
+				rung++;
+		}
+		rung = std::min(rung, ceiling);
+
+		// -- Apply : restarts the stream, only when needed
+		const double target = _ladder[rung];
+		if(target != _fps && _device.setFrameRate(target))
+			_fps = target;
+
+		return _fps.load();
+	}
+
+	// Getters
+	double getFrameRate() const {
+		return _fps;
+	}
+	double getCpuLoad() const {
+		return _cpuLoad;
+	}
+
+private:
+	// Threaded function
+	void _loop() {
+		_clock.beg();
+		_lastCpuMus = _device.getCaptureCpuMus();
+
+		for(Timer timer; _running; Timer::wait(100)) {
+			if(timer.elapsed_mus() < 1000LL * _options.periodMs)
+				continue;
+
+			timer.beg();
+			update();
+		}
+	}
+
+	// Highest rung not above the frame rate
+	size_t _rungOf(double fps) const {
+		size_t rung = 0;
+		for(size_t i = 0; i < _ladder.size(); i++)
+			if(_ladder[i] <= fps + 0.01)
+				rung = i;
+		return rung;
+	}
+
+	// Members
+	DeviceMt& _device;
+	const Options _options;
+	std::vector<double> _ladder;
+
+	std::atomic<double> _fps;
+	std::atomic<double> _cpuLoad;
+
+	std::atomic<bool> _running;
+	std::shared_ptr<std::thread> _pThread;
+
+	Timer _clock;
+	uint64_t _lastCpuMus;
+
+	std::mutex _mutCbk;
+	DemandFunction _cbkDemand;
+	BacklogFunction _cbkBacklog;
+};
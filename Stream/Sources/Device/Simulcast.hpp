@@ -0,0 +1,229 @@
+#pragma once
+
+#include <csetjmp>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <mutex>
+
+#include <jpeglib.h>
+
+#include "structures.hpp"
+
+// ------------ Simulcast : Reduced resolutions of a frame, each layer encoded once ------------
+// Mjpeg source : decoded with the libjpeg-turbo DCT scaling (1/2, 1/4, 1/8) then re-encoded.
+// Yuyv source  : box downscaled then encoded, without any color conversion.
+class Simulcast {
+public:
+	// Structures
+	struct Layer {
+		int scaleDenom;	// 1 : source resolution
+		int quality;		// Jpeg quality of the re-encoded layers
+	};
+
+private:
+	// Jpeg errors : jump back instead of exit()
+	struct _ErrorMgr {
+		struct jpeg_error_mgr pub;
+		jmp_buf jump;
+	};
+
+public:
+	// Constructor
+	Simulcast() : _layers({Layer{1, 0}}), _out(nullptr), _outSize(0) {
+		_decoder.err = jpeg_std_error(&_decoderErr.pub);
+		_decoderErr.pub.error_exit = &Simulcast::_onError;
+		_decoderErr.pub.output_message = &Simulcast::_onMessage; // Usb cameras : a lot of harmless warnings
+		jpeg_create_decompress(&_decoder);
+
+		_encoder.err = jpeg_std_error(&_encoderErr.pub);
+		_encoderErr.pub.error_exit = &Simulcast::_onError;
+		jpeg_create_compress(&_encoder);
+	}
+	~Simulcast() {
+		jpeg_destroy_decompress(&_decoder);
+		jpeg_destroy_compress(&_encoder);
+	}
+
+	// - Methods
+	// Add a reduced layer, return its id. Layer 0 is always the source.
+	int addLayer(int scaleDenom, int quality = 60) {
+		std::lock_guard<std::mutex> lockCodec(_mutCodec);
+
+		if(scaleDenom != 2 && scaleDenom != 4 && scaleDenom != 8)
+			scaleDenom = 2;
+
+		_layers.push_back(Layer{scaleDenom, quality});
+		return static_cast<int>(_layers.size()) - 1;
+	}
+
+	// Produce the layer from the source frame
+	bool encode(const Gb::Frame& source, int idLayer, Gb::Frame& layer) {
+		std::lock_guard<std::mutex> lockCodec(_mutCodec);
+
+		if(idLayer < 0 || idLayer >= static_cast<int>(_layers.size()) || source.empty())
+			return false;
+
+		const Layer& params(_layers[idLayer]);
+		if(params.scaleDenom == 1 && _isJpeg(source)) {
+			layer = source;
+			return true;
+		}
+
+		bool success = _isJpeg(source) ?
+			_scaleJpeg(source, params, layer) :
+			_scaleYuyv(source, params, layer);
+
+		if(success) {
+			layer.timestamp = source.timestamp;
+			layer.exposure  = source.exposure;
+		}
+		return success;
+	}
+
+	// Getters
+	size_t count() const {
+		std::lock_guard<std::mutex> lockCodec(_mutCodec);
+		return _layers.size();
+	}
+	Gb::Size layerSize(int idLayer, const Gb::Size& source) const {
+		std::lock_guard<std::mutex> lockCodec(_mutCodec);
+		if(idLayer < 0 || idLayer >= static_cast<int>(_layers.size()))
+			return Gb::Size(0,0);
+
+		const int denom = _layers[idLayer].scaleDenom;
+		return Gb::Size((source.width + denom-1) / denom, (source.height + denom-1) / denom);
+	}
+
+private:
+	// Statics
+	static void _onError(j_common_ptr cinfo) {
+		_ErrorMgr* err = reinterpret_cast<_ErrorMgr*>(cinfo->err);
+		longjmp(err->jump, 1);
+	}
+	static void _onMessage(j_common_ptr) {
+		// Silent
+	}
+	static bool _isJpeg(const Gb::Frame& frame) {
+		return frame.length() > 2 && frame.buffer[0] == 0xFF && frame.buffer[1] == 0xD8;
+	}
+
+	// Methods
+	bool _scaleJpeg(const Gb::Frame& source, const Layer& params, Gb::Frame& layer) {
+		if(setjmp(_decoderErr.jump)) {
+			jpeg_abort_decompress(&_decoder);
+			return false;
+		}
+
+		jpeg_mem_src(&_decoder, const_cast<unsigned char*>(source.start()), source.length());
+		if(jpeg_read_header(&_decoder, TRUE) != JPEG_HEADER_OK) {
+			jpeg_abort_decompress(&_decoder);
+			return false;
+		}
+
+		// Scaled in the DCT domain, no color conversion
+		_decoder.scale_num 			= 1;
+		_decoder.scale_denom 		= params.scaleDenom;
+		_decoder.out_color_space 	= _decoder.jpeg_color_space == JCS_GRAYSCALE ? JCS_GRAYSCALE : JCS_YCbCr;
+		_decoder.dct_method 		= JDCT_IFAST;
+		_decoder.do_fancy_upsampling = FALSE;
+
+		jpeg_start_decompress(&_decoder);
+
+		const int width  	= _decoder.output_width;
+		const int height 	= _decoder.output_height;
+		const int channels	= _decoder.output_components;
+		_pixels.resize(static_cast<size_t>(width) * height * channels);
+
+		while(_decoder.output_scanline < _decoder.output_height) {
+			JSAMPROW row = &_pixels[static_cast<size_t>(_decoder.output_scanline) * width * channels];
+			jpeg_read_scanlines(&_decoder, &row, 1);
+		}
+		jpeg_finish_decompress(&_decoder);
+
+		return _encode(width, height, channels, channels == 1 ? JCS_GRAYSCALE : JCS_YCbCr, params.quality, layer);
+	}
+
+	bool _scaleYuyv(const Gb::Frame& source, const Layer& params, Gb::Frame& layer) {
+		const int denom  = params.scaleDenom;
+		const int width  = source.size.width / denom;
+		const int height = source.size.height / denom;
+
+		if(width <= 0 || height <= 0 || source.length() < static_cast<unsigned long>(source.size.area()) * 2)
+			return false;
+
+		// Box filter of [Y U Y V] to interleaved YCbCr
+		const size_t stride = static_cast<size_t>(source.size.width) * 2;
+		const int nPix = denom * denom;
+		_pixels.resize(static_cast<size_t>(width) * height * 3);
+
+		for(int y = 0; y < height; y++) {
+			unsigned char* dst = &_pixels[static_cast<size_t>(y) * width * 3];
+
+			for(int x = 0; x < width; x++, dst += 3) {
+				int sumY = 0, sumU = 0, sumV = 0;
+
+				for(int dy = 0; dy < denom; dy++) {
+					const unsigned char* row = &source.buffer[(y*denom + dy) * stride];
+					for(int dx = 0; dx < denom; dx++) {
+						const int px = x*denom + dx;
+						sumY += row[2*px];
+						sumU += row[4*(px/2) + 1];
+						sumV += row[4*(px/2) + 3];
+					}
+				}
+
+				dst[0] = static_cast<unsigned char>((sumY + nPix/2) / nPix);
+				dst[1] = static_cast<unsigned char>((sumU + nPix/2) / nPix);
+				dst[2] = static_cast<unsigned char>((sumV + nPix/2) / nPix);
+			}
+		}
+
+		return _encode(width, height, 3, JCS_YCbCr, params.quality, layer);
+	}
+
+	bool _encode(int width, int height, int channels, J_COLOR_SPACE colorSpace, int quality, Gb::Frame& layer) {
+		_out = nullptr;
+		_outSize = 0;
+
+		if(setjmp(_encoderErr.jump)) {
+			jpeg_abort_compress(&_encoder);
+			free(_out);
+			return false;
+		}
+
+		jpeg_mem_dest(&_encoder, &_out, &_outSize);
+
+		_encoder.image_width 		= width;
+		_encoder.image_height 		= height;
+		_encoder.input_components 	= channels;
+		_encoder.in_color_space 	= colorSpace;
+		jpeg_set_defaults(&_encoder);
+		jpeg_set_quality(&_encoder, quality, TRUE);
+		_encoder.dct_method = JDCT_IFAST;
+
+		jpeg_start_compress(&_encoder, TRUE);
+		while(_encoder.next_scanline < _encoder.image_height) {
+			JSAMPROW row = &_pixels[static_cast<size_t>(_encoder.next_scanline) * width * channels];
+			jpeg_write_scanlines(&_encoder, &row, 1);
+		}
+		jpeg_finish_compress(&_encoder);
+
+		layer = Gb::Frame(_out, _outSize, Gb::Size(width, height));
+		free(_out);
+
+		return !layer.empty();
+	}
+
+	// Members
+	std::vector<Layer> _layers;
+
+	mutable std::mutex _mutCodec;
+	struct jpeg_decompress_struct _decoder;
+	struct jpeg_compress_struct _encoder;
+	_ErrorMgr _decoderErr;
+	_ErrorMgr _encoderErr;
+	std::vector<unsigned char> _pixels;
+	unsigned char* _out;		// Allocated by libjpeg
+	unsigned long _outSize;
+};
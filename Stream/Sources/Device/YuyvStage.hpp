@@ -0,0 +1,202 @@
+#pragma once
+
+#include <cstdint>
+#include <algorithm>
+
+#include "structures.hpp"
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+	#include <arm_neon.h>
+	#define YUYV_NEON
+#elif defined(__SSE2__)
+	#include <emmintrin.h>
+	#define YUYV_SSE2
+#endif
+
+// ------------ YuyvStage : Luma plane from a YUYV frame, cropped and downscaled (box filter) ------------
+class YuyvStage {
+public:
+	// Structures
+	struct Roi {
+		Roi(int x_ = 0, int y_ = 0, int w = 0, int h = 0) : x(x_), y(y_), width(w), height(h) {
+		}
+
+		int x;
+		int y;
+		int width;	// 0 : until the end of the frame
+		int height;
+	};
+
+public:
+	// Constructor
+	explicit YuyvStage(int scale = 1, const Roi& roi = Roi()) :
+		_scale(scale == 4 ? 4 : (scale == 2 ? 2 : 1)),
+		_roi(roi)
+	{
+		// Ready
+	}
+
+	// - Methods
+	// yuyv.size is the size in pixels, gray receives a single 8 bits plane
+	bool process(const Gb::Frame& yuyv, Gb::Frame& gray) const {
+		const int width  = yuyv.size.width;
+		const int height = yuyv.size.height;
+
+		if(yuyv.empty() || yuyv.length() < static_cast<unsigned long>(width) * height * 2)
+			return false;
+
+		// Region, aligned on the macro pixels and the scale
+		const int align = std::max(2, _scale);
+		int x = std::max(0, std::min(_roi.x, width)) / align * align;
+		int y = std::max(0, std::min(_roi.y, height));
+		int w = _roi.width  > 0 ? std::min(_roi.width,  width - x)  : width - x;
+		int h = _roi.height > 0 ? std::min(_roi.height, height - y) : height - y;
+
+		const int outWidth  = w / _scale;
+		const int outHeight = h / _scale;
+		if(outWidth <= 0 || outHeight <= 0)
+			return false;
+
+		gray.buffer.resize(static_cast<size_t>(outWidth) * outHeight);
+		gray.size 		= Gb::Size(outWidth, outHeight);
+		gray.timestamp	= yuyv.timestamp;
+		gray.exposure	= yuyv.exposure;
+
+		const size_t stride = static_cast<size_t>(width) * 2;
+		const unsigned char* src = &yuyv.buffer[0] + y * stride + x * 2;
+		unsigned char* dst = &gray.buffer[0];
+
+		switch(_scale) {
+			case 1: luma(src, stride, dst, outWidth, outWidth, outHeight);		break;
+			case 2: luma2(src, stride, dst, outWidth, outWidth, outHeight);		break;
+			case 4: luma4(src, stride, dst, outWidth, outWidth, outHeight);		break;
+		}
+
+		return true;
+	}
+
+	// -- Kernels : output size (width, height), input rows have srcStride bytes
+	static void luma(const unsigned char* src, size_t srcStride, unsigned char* dst, size_t dstStride, int width, int height) {
+		for(int row = 0; row < height; row++, src += srcStride, dst += dstStride) {
+			int i = 0;
+#if defined(YUYV_NEON)
+			for(; i + 16 <= width; i += 16) {
+				uint8x16x2_t yuv = vld2q_u8(src + 2*i);
+				vst1q_u8(dst + i, yuv.val[0]);
+			}
+#elif defined(YUYV_SSE2)
+			const __m128i lowBytes = _mm_set1_epi16(0x00FF);
+			for(; i + 16 <= width; i += 16) {
+				__m128i a = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 2*i)), lowBytes);
+				__m128i b = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 2*i + 16)), lowBytes);
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(a, b));
+			}
+#endif
+			for(; i < width; i++)
+				dst[i] = src[2*i];
+		}
+	}
+
+	static void luma2(const unsigned char* src, size_t srcStride, unsigned char* dst, size_t dstStride, int width, int height) {
+		for(int row = 0; row < height; row++, src += 2*srcStride, dst += dstStride) {
+			const unsigned char* r0 = src;
+			const unsigned char* r1 = src + srcStride;
+
+			int i = 0;
+#if defined(YUYV_NEON)
+			for(; i + 16 <= width; i += 16) {
+				// [Y0 U Y1 V] : val[0] and val[2] are the two pixels of an output
+				uint8x16x4_t a = vld4q_u8(r0 + 4*i);
+				uint8x16x4_t b = vld4q_u8(r1 + 4*i);
+
+				uint16x8_t lo = vaddl_u8(vget_low_u8(a.val[0]), vget_low_u8(a.val[2]));
+				lo = vaddw_u8(lo, vget_low_u8(b.val[0]));
+				lo = vaddw_u8(lo, vget_low_u8(b.val[2]));
+
+				uint16x8_t hi = vaddl_u8(vget_high_u8(a.val[0]), vget_high_u8(a.val[2]));
+				hi = vaddw_u8(hi, vget_high_u8(b.val[0]));
+				hi = vaddw_u8(hi, vget_high_u8(b.val[2]));
+
+				vst1q_u8(dst + i, vcombine_u8(vrshrn_n_u16(lo, 2), vrshrn_n_u16(hi, 2)));
+			}
+#elif defined(YUYV_SSE2)
+			const __m128i lowBytes = _mm_set1_epi16(0x00FF);
+			const __m128i ones = _mm_set1_epi16(1);
+			const __m128i two  = _mm_set1_epi16(2);
+			for(; i + 8 <= width; i += 8) {
+				// Vertical sum of the lumas (16 bits)
+				__m128i lo = _mm_add_epi16(
+					_mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(r0 + 4*i)), lowBytes),
+					_mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(r1 + 4*i)), lowBytes)
+				);
+				__m128i hi = _mm_add_epi16(
+					_mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(r0 + 4*i + 16)), lowBytes),
+					_mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(r1 + 4*i + 16)), lowBytes)
+				);
+
+				// Horizontal pairs, rounded average
+				__m128i sum = _mm_packs_epi32(_mm_madd_epi16(lo, ones), _mm_madd_epi16(hi, ones));
+				sum = _mm_srli_epi16(_mm_add_epi16(sum, two), 2);
+				_mm_storel_epi64(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(sum, sum));
+			}
+#endif
+			for(; i < width; i++)
+				dst[i] = static_cast<unsigned char>((r0[4*i] + r0[4*i+2] + r1[4*i] + r1[4*i+2] + 2) >> 2);
+		}
+	}
+
+	static void luma4(const unsigned char* src, size_t srcStride, unsigned char* dst, size_t dstStride, int width, int height) {
+		for(int row = 0; row < height; row++, src += 4*srcStride, dst += dstStride) {
+			const unsigned char* r[4] = {src, src + srcStride, src + 2*srcStride, src + 3*srcStride};
+
+			int i = 0;
+#if defined(YUYV_NEON)
+			for(; i + 8 <= width; i += 8) {
+				// Pairs of pixels of the 4 rows (16 bits)
+				uint16x8_t lo = vdupq_n_u16(0);
+				uint16x8_t hi = vdupq_n_u16(0);
+				for(int k = 0; k < 4; k++) {
+					uint8x16x4_t a = vld4q_u8(r[k] + 8*i);
+					lo = vaddq_u16(lo, vaddl_u8(vget_low_u8(a.val[0]),  vget_low_u8(a.val[2])));
+					hi = vaddq_u16(hi, vaddl_u8(vget_high_u8(a.val[0]), vget_high_u8(a.val[2])));
+				}
+
+				// Adjacent pairs, rounded average
+				uint16x8_t sum = vcombine_u16(vrshrn_n_u32(vpaddlq_u16(lo), 4), vrshrn_n_u32(vpaddlq_u16(hi), 4));
+				vst1_u8(dst + i, vmovn_u16(sum));
+			}
+#elif defined(YUYV_SSE2)
+			const __m128i lowBytes = _mm_set1_epi16(0x00FF);
+			const __m128i ones  = _mm_set1_epi16(1);
+			const __m128i eight = _mm_set1_epi32(8);
+			for(; i + 4 <= width; i += 4) {
+				// Vertical sum of the lumas (16 bits)
+				__m128i lo = _mm_setzero_si128();
+				__m128i hi = _mm_setzero_si128();
+				for(int k = 0; k < 4; k++) {
+					lo = _mm_add_epi16(lo, _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(r[k] + 8*i)), lowBytes));
+					hi = _mm_add_epi16(hi, _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(r[k] + 8*i + 16)), lowBytes));
+				}
+
+				// Horizontal : pairs then quads, rounded average
+				__m128i pairs = _mm_packs_epi32(_mm_madd_epi16(lo, ones), _mm_madd_epi16(hi, ones));
+				__m128i sum = _mm_srli_epi32(_mm_add_epi32(_mm_madd_epi16(pairs, ones), eight), 4);
+				sum = _mm_packs_epi32(sum, sum);
+				int32_t packed = _mm_cvtsi128_si32(_mm_packus_epi16(sum, sum));
+				memcpy(dst + i, &packed, 4);
+			}
+#endif
+			for(; i < width; i++) {
+				int sum = 0;
+				for(int k = 0; k < 4; k++)
+					sum += r[k][8*i] + r[k][8*i+2] + r[k][8*i+4] + r[k][8*i+6];
+				dst[i] = static_cast<unsigned char>((sum + 8) >> 4);
+			}
+		}
+	}
+
+private:
+	// Members
+	int _scale;
+	Roi _roi;
+};
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <cstring>
 #include <cstdlib>
 #include <iostream>
@@ -20,13 +21,17 @@ namespace Gb {
 	
 	struct Frame {
 		// Constructors
-		Frame(unsigned char* start = nullptr, unsigned long len = 0, const Size& s = Size(0,0)) : buffer(start, start+len), size(s) {	
+		Frame(unsigned char* start = nullptr, unsigned long len = 0, const Size& s = Size(0,0)) : buffer(start, start+len), size(s), timestamp(0), exposure(0), sequence(0), dequeued(0) {	
 		}
-		Frame(const Frame& f) : buffer(f.buffer), size(f.size) {
+		Frame(const Frame& f) : buffer(f.buffer), size(f.size), timestamp(f.timestamp), exposure(f.exposure), sequence(f.sequence), dequeued(f.dequeued) {
 		}
 		Frame& operator=(const Frame& f) {
 			buffer = f.buffer;
 			size = f.size;
+			timestamp = f.timestamp;
+			exposure = f.exposure;
+			sequence = f.sequence;
+			dequeued = f.dequeued;
 			return *this;
 		}
 		~Frame() {
@@ -36,11 +41,19 @@ namespace Gb {
 		// Members
 		std::vector<unsigned char> buffer;
 		Size size;
+		uint64_t timestamp;	// Start of exposure, monotonic clock (mus). 0 if unknown
+		uint32_t exposure;	// Exposure duration (mus). 0 if unknown
+		uint32_t sequence;	// Counted by the driver : a gap is a dropped frame
+		uint64_t dequeued;	// Given by the driver, monotonic clock (mus). 0 if unknown
 		
 		// Methods
 		void clear() {
 			buffer.clear();
 			size = Size(0,0);
+			timestamp = 0;
+			exposure = 0;
+			sequence = 0;
+			dequeued = 0;
 		}
 		
 		bool empty() const {
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+// ------------ Histogram : Lock free log-linear histogram of durations (mus) ------------
+// 16 linear buckets per power of 2 : any value is known within 6%. Safe to add from any thread.
+class Histogram {
+public:
+	struct Summary {
+		uint64_t count 	= 0;
+		uint64_t p50 	= 0;
+		uint64_t p99 	= 0;
+		uint64_t p999 	= 0;
+		uint64_t max 	= 0;
+	};
+
+	// Constructor
+	Histogram() {
+		reset();
+	}
+	Histogram(const Histogram&) = delete;
+	Histogram& operator=(const Histogram&) = delete;
+
+	// Methods
+	void add(uint64_t value) {
+		_buckets[_index(value)].fetch_add(1, std::memory_order_relaxed);
+		_count.fetch_add(1, std::memory_order_relaxed);
+
+		uint64_t max = _max.load(std::memory_order_relaxed);
+		while(value > max && !_max.compare_exchange_weak(max, value, std::memory_order_relaxed)) {
+		}
+	}
+	void reset() {
+		for(size_t i = 0; i < _BUCKETS; i++)
+			_buckets[i].store(0, std::memory_order_relaxed);
+
+		_count.store(0, std::memory_order_relaxed);
+		_max.store(0, std::memory_order_relaxed);
+	}
+
+	// Getters
+	uint64_t count() const {
+		return _count.load(std::memory_order_relaxed);
+	}
+	uint64_t max() const {
+		return _max.load(std::memory_order_relaxed);
+	}
+
+	// Upper bound of the bucket holding the quantile q (0..1). 0 if empty.
+	uint64_t percentile(double q) const {
+		const uint64_t total = count();
+		if(total == 0)
+			return 0;
+
+		uint64_t rank = static_cast<uint64_t>(q * static_cast<double>(total) + 0.5);
+		rank = rank < 1 ? 1 : (rank > total ? total : rank);
+
+		uint64_t seen = 0;
+		for(size_t i = 0; i < _BUCKETS; i++) {
+			seen += _buckets[i].load(std::memory_order_relaxed);
+			if(seen >= rank) {
+				const uint64_t upper = _lowerBound(i + 1) - 1;
+				return upper < max() ? upper : max();
+			}
+		}
+		return max();
+	}
+	Summary summary() const {
+		Summary result;
+		result.count 	= count();
+		result.p50 		= percentile(0.50);
+		result.p99 		= percentile(0.99);
+		result.p999 	= percentile(0.999);
+		result.max 		= max();
+		return result;
+	}
+
+private:
+	static const int _SUB_BITS 	= 4;
+	static const size_t _SUB_COUNT 	= 1 << _SUB_BITS;
+	static const size_t _BUCKETS 	= _SUB_COUNT + (64 - _SUB_BITS) * _SUB_COUNT;
+
+	// Values under 16 : one bucket each. Then 16 buckets for each power of 2.
+	static size_t _index(uint64_t value) {
+		if(value < _SUB_COUNT)
+			return static_cast<size_t>(value);
+
+	#if defined(__GNUC__)
+		const int msb = 63 - __builtin_clzll(value);
+	#else
+		int msb = 0;
+		for(uint64_t v = value; v > 1; v >>= 1)
+			msb++;
+	#endif
+		const size_t sub = static_cast<size_t>(value >> (msb - _SUB_BITS)) - _SUB_COUNT;
+		return _SUB_COUNT + static_cast<size_t>(msb - _SUB_BITS) * _SUB_COUNT + sub;
+	}
+	static uint64_t _lowerBound(size_t index) {
+		if(index < _SUB_COUNT)
+			return index;
+		if(index >= _BUCKETS)
+			return UINT64_MAX;
+
+		const size_t group = (index - _SUB_COUNT) / _SUB_COUNT;
+		const uint64_t sub = (index - _SUB_COUNT) % _SUB_COUNT;
+		return (_SUB_COUNT + sub) << group;
+	}
+
+	// Members
+	std::atomic<uint64_t> _buckets[_BUCKETS];
+	std::atomic<uint64_t> _count;
+	std::atomic<uint64_t> _max;
+};
@@ -1,8 +1,10 @@
 #pragma once
 
 #include "i2cDevice.hpp"
+#include "../Timer.hpp"
 
 #include <iostream>
+#include <cstring>
 
 class Mpu_6050 : public i2cDevice {
 public:
@@ -14,9 +16,11 @@ public:
 	};
 	
 	struct Data {
+		uint64_t timestamp;	 // Sampling time, monotonic clock (mus)
 		double temperature; // celsius
 		vec3 accel;			 // LSB/g
 		vec3 gyro;			 // LSB/deg/second
+		int16_t raw[7];		 // As read : accel x y z, temperature, gyro x y z
 	};
 	
 private:
@@ -35,7 +39,7 @@ private:
 	
 public:
 	// Constructor
-	Mpu_6050() : fifoBuffer {0} {
+	Mpu_6050() : fifoBuffer {0}, _samplePeriodMus(0) {
 		// Wait for open();
 	}
 	
@@ -55,6 +59,7 @@ public:
 		int sampleRate = 40; // /s
 		int8_t irate = (8000 / sampleRate) -1;
 		write8t(SAMPLE_RATE, irate);
+		_samplePeriodMus = 1000000 / sampleRate;
 
 		// Enable fifo
         writeBit(MPU_POWER0, 6, 1); // Enable fifo operations
@@ -71,6 +76,7 @@ public:
 			return false;
 
 		// Read fifo register
+		uint64_t now = Timer::monotonicMus();
 		readBytes(FIFO_RW, 14, (__u8 *)fifoBuffer);
 		
 		for(int8_t i = 0; i < 7; i++)
@@ -90,6 +96,11 @@ public:
 		
 		// Convert
 		scaledData(rawdata, data);
+		memcpy(data.raw, fifoBuffer, sizeof(data.raw));
+		
+		// The oldest sample is read first : the others in the fifo came after it
+		uint64_t samplesAfter = static_cast<uint64_t>(countFifo / 14 - 1);
+		data.timestamp = now - samplesAfter * _samplePeriodMus;
 		
 		return true;
 	}
@@ -105,6 +116,24 @@ public:
 		data.gyro.y = _scaledGyro(rawdata.gyro.y);
 		data.gyro.z = _scaledGyro(rawdata.gyro.z);
 	}
+	
+	// Getters
+	uint64_t samplePeriod() const {
+		return _samplePeriodMus;
+	}
+	// Units by LSB of the raw values, at the ranges set by start()
+	static double accelScale() {
+		return 9.80665 / 16384.0; // m/s2, 2G
+	}
+	static double gyroScale() {
+		return 1.0 / 131.0; // deg/s, 250 deg/s
+	}
+	static double temperatureScale() {
+		return 1.0 / 340.0;
+	}
+	static double temperatureOffset() {
+		return 36.53;
+	}
 
 private:
 	
@@ -152,13 +181,13 @@ private:
 	};
 	
 	double _scaledTemp(const int16_t rawTemp) const {
-		return (rawTemp / 340.0) + 36.53;
+		return rawTemp * temperatureScale() + temperatureOffset();
 	}
 	double _scaledAccel(const int16_t rawAccel) const {
-		return 9.80665 * _signed(rawAccel) / 16384.0;
+		return _signed(rawAccel) * accelScale();
 	}
 	double _scaledGyro(const int16_t rawGyro) const {
-		return _signed(rawGyro) / 131.0;
+		return _signed(rawGyro) * gyroScale();
 	}
 	int _signed(const int16_t val) const {
 		int signedVal = (val >= 0x8000) ? -(65536 - val) : val;
@@ -167,4 +196,5 @@ private:
 	
 	// Members
 	int16_t fifoBuffer[7];
+	uint64_t _samplePeriodMus;
 };
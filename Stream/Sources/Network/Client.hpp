@@ -9,15 +9,18 @@
 #include <vector>
 #include <algorithm>
 #include <functional>
+#include <cstdlib>
 
 #include "WinLinConversion.hpp"
 #include "Message.hpp"
+#include "Fragment.hpp"
+#include "Uring.hpp"
 #include "../Timer.hpp"
 
 class Client {
 	// -------------- Main class --------------
 public:
-	Client() : _isConnected(false), _isAlive(false), _udpSock(INVALID_SOCKET), _tcpSock(INVALID_SOCKET) {
+	Client() : _isConnected(false), _isAlive(false), _udpSock(INVALID_SOCKET), _tcpSock(INVALID_SOCKET), _multicastSock(INVALID_SOCKET), _multicastAllowed(true), _stopFd(-1), _uringWanted(false), _uring(false) {
 		// Wait for connectTo
 	}
 	~Client() {
@@ -30,6 +33,13 @@ public:
 		if(_isConnected)
 			return;
 		
+		// Previous connection lost, or disconnect() called from a callback : its loop is joined and its sockets closed.
+		// Not from a callback then, the loop can't join itself.
+		if(_idLoop.load() == std::this_thread::get_id())
+			return;
+		if(_pLoop)
+			disconnect();
+		
 		// Init windows sockets
 		if(!wlc::initSockets())
 			return;
@@ -39,7 +49,7 @@ public:
 		
 		_address.sin_family	= AF_INET;
 		_address.sin_port 	= htons(port);
-		InetPton(AF_INET, ipAddress.c_str(), &_address.sin_addr.s_addr);
+		wlc::inetPton(ipAddress.c_str(), &_address.sin_addr);
 		
 		// Create sockets
 		_udpSock = socket(PF_INET, SOCK_DGRAM , IPPROTO_UDP);
@@ -60,33 +70,101 @@ public:
 		
 		if(wlc::setNonBlocking(_tcpSock, true) < 0)
 			return disconnect();	
+		
+		wlc::setReceiveBuffer(_udpSock, 4 << 20); // Best effort
+		
+		// Datagrams buffers, allocated once : a burst of fragments is read at once
+		if(!_udpBuffer)
+			_udpBuffer.reset(new char[_UDP_BATCH * _UDP_SLOT_SIZE]);
+		
+#ifdef __linux__
+		for(size_t i = 0; i < _UDP_BATCH; i++) {
+			_udpSlots[i].iov_base 	= _udpBuffer.get() + i * _UDP_SLOT_SIZE;
+			_udpSlots[i].iov_len 	= _UDP_SLOT_SIZE;
+			
+			_datagrams[i] = mmsghdr();
+			_datagrams[i].msg_hdr.msg_iov 		= &_udpSlots[i];
+			_datagrams[i].msg_hdr.msg_iovlen 	= 1;
+		}
+		
+		_stopFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+		if(_stopFd == -1)
+			return disconnect();
+#endif
 
 		// Thread
 		_isAlive = true;
-		_pRecvTcp = std::make_shared<std::thread>(&Client::_recvTcp, this);
-		_pRecvUdp = std::make_shared<std::thread>(&Client::_recvUdp, this);
+#ifdef URING_AVAILABLE
+		if(_startUring())
+			return;
+#endif
+		_pLoop = std::make_shared<std::thread>(&Client::_loop, this);
 	}
 	
 	void disconnect() {
 		_isConnected = false;
 		_isAlive = false;
 		
-		if(_pRecvTcp)
-			if(_pRecvTcp->joinable())
-				_pRecvTcp->join();
-			
-		if(_pRecvUdp)
-			if(_pRecvUdp->joinable())
-				_pRecvUdp->join();
+#ifdef __linux__
+		if(_stopFd != -1) {
+			uint64_t one = 1;
+			if(write(_stopFd, &one, sizeof(one)) != sizeof(one))
+				perror(" [Client] Stopping");
+		}
+#endif
+		
+		// May be called from a callback, even before _pLoop is set : the loop ends by itself
+		if(_idLoop.load() == std::this_thread::get_id())
+			return;
+		
+		if(_pLoop)
+			if(_pLoop->joinable())
+				_pLoop->join();
+		_pLoop.reset();
+		_idLoop = std::thread::id();
+		
+#ifdef __linux__
+		if(_stopFd != -1)
+			close(_stopFd);
+		_stopFd = -1;
+#endif
+#ifdef URING_AVAILABLE
+		_stopUring();
+#endif
 		
 		wlc::closeSocket(_udpSock);
 		wlc::closeSocket(_tcpSock);
+		if(_multicastSock != INVALID_SOCKET)
+			wlc::closeSocket(_multicastSock);
+		_udpSock = INVALID_SOCKET;
+		_tcpSock = INVALID_SOCKET;
+		_multicastSock = INVALID_SOCKET;
+		_received.clear();
+		
+		// A new connection, maybe to a restarted server : its messages are numbered from 0 again
+		_buffering = false;
+		_sizeWaited = 0;
+		_msgSerializedBuffer.clear();
+		_mutFragments.lock();
+		_reassembler = Reassembler();
+		_mutFragments.unlock();
 		
 		wlc::uninitSockets();
 	}
 	
+	// Join the multicast group when the server invites it (default). Else everything comes by unicast.
+	void allowMulticast(bool allow) {
+		_multicastAllowed = allow;
+	}
+	
+	// Linux : io_uring instead of poll (multishot receives in kernel buffers), if the kernel has it (6.0). Before connectTo().
+	// Its buffers take datagrams up to 2KB, enough for the server's : bigger ones are dropped (and reported), poll reads any size.
+	void preferUring(bool prefer) {
+		_uringWanted = prefer;
+	}
+	
 	void sendInfo(const Message& msg) const {
-		if(send(_tcpSock, msg.data(), (int)msg.length(), 0) != (int)msg.length()) {
+		if(wlc::sendBuffers(_tcpSock, msg.header(), Message::HEADER_SIZE, msg.content(), msg.size()) != (int)msg.length()) {
 			std::lock_guard<std::mutex> lockCbk(_mutCbk);
 			if(_cbkError) 
 				_cbkError(Error(wlc::getError(), "TCP send Error"));
@@ -94,7 +172,7 @@ public:
 	}
 	
 	void sendData(const Message& msg) const {		
-		if(sendto(_udpSock, msg.data(), (int)msg.length(), 0, (sockaddr*) &_address, sizeof(_address)) != (int)msg.length()) {
+		if(wlc::sendBuffers(_udpSock, msg.header(), Message::HEADER_SIZE, msg.content(), msg.size(), &_address) != (int)msg.length()) {
 			std::lock_guard<std::mutex> lockCbk(_mutCbk);
 			if(_cbkError) 
 				_cbkError(Error(wlc::getError(), "UDP send Error"));
@@ -105,17 +183,27 @@ public:
 	bool isConnected() const {
 		return _isConnected;
 	}
+	bool isUring() const {
+		return _uring;
+	}
+	bool isMulticast() const {
+		return _multicastSock != INVALID_SOCKET;
+	}
+	const Reassembler::Stats getFragmentStats() const {
+		std::lock_guard<std::mutex> lockFragments(_mutFragments);
+		return _reassembler.getStats();
+	}
 	
 	// Setters
 	void onConnect(const std::function<void(void)>& cbkConnect) {
 		std::lock_guard<std::mutex> lockCbk(_mutCbk);
 		_cbkConnect = cbkConnect;
 	}
-	void onInfo(const std::function<void(const Message& message)>& cbkInfo) {
+	void onInfo(const std::function<void(const MessageView& message)>& cbkInfo) {
 		std::lock_guard<std::mutex> lockCbk(_mutCbk);
 		_cbkInfo = cbkInfo;	
 	}
-	void onData(const std::function<void(const Message& message)>& ckbData) {
+	void onData(const std::function<void(const MessageView& message)>& ckbData) {
 		std::lock_guard<std::mutex> lockCbk(_mutCbk);
 		_cbkData = ckbData;		
 	}
@@ -125,168 +213,519 @@ public:
 	}
 	
 private:	
-	// Methods in threads
-	void _recvTcp() {
-		const int BUFFER_SIZE = 2048; 
-		char buf[BUFFER_SIZE] = {0};
-		ssize_t recv_len = 0;
-		
-		for(Timer timer; _isAlive; ) {
-			// Receive TCP maybe
-			memset(buf, 0, BUFFER_SIZE);
+	// Method in thread : wait for both sockets, read what is ready
+	void _loop() {
+		_idLoop = std::this_thread::get_id();
+		
+		struct pollfd fds[4] = {};
+		fds[0].fd = _tcpSock;
+		fds[0].events = POLLIN;
+		fds[1].fd = _udpSock;
+		fds[1].events = POLLIN;
+		fds[2].events = POLLIN; // Multicast, once joined
+		
+#ifdef __linux__
+		fds[3].fd = _stopFd;
+		fds[3].events = POLLIN;
+		const unsigned long nFds = 4;
+		const int timeout = -1;
+#else
+		const unsigned long nFds = 3;
+		const int timeout = _POLL_TIMEOUT_MS;
+#endif
+		
+		while(_isAlive) {
+			fds[2].fd = _multicastSock; // Invalid : ignored
+			if(wlc::pollSockets(fds, nFds, timeout) == SOCKET_ERROR) {
+				int error = wlc::getError();
+				if(error == EINTR)
+					continue;
+				
+				std::lock_guard<std::mutex> lockCbk(_mutCbk);
+				if(_cbkError) 
+					_cbkError(Error(error, "Client poll Error"));
+				break;
+			}
 			
-			if((recv_len = recv(_tcpSock, buf, BUFFER_SIZE, 0)) == SOCKET_ERROR) {
+			if(fds[0].revents != 0 && !_readTcp())
+				break;
+			
+			if(fds[1].revents != 0 && !_readUdp(_udpSock))
+				break;
+			
+			if(fds[2].revents != 0 && _multicastSock != INVALID_SOCKET && !_readUdp(_multicastSock))
+				break;
+		}
+		
+		// Forcibly disconnected
+		_isConnected = false;
+		_isAlive = false;
+	}
+	
+	// Until nothing is left. False when the server is gone.
+	bool _readTcp() {
+		char buf[_TCP_BUFFER_SIZE];
+		
+		for(;;) {
+			const ssize_t recv_len = recv(_tcpSock, buf, sizeof(buf), 0);
+			if(recv_len > 0) {
+				_onTcpData(buf, (size_t)recv_len);
+				continue;
+			}
+			
+			if(recv_len == SOCKET_ERROR) {
 				// What kind of error ?
 				int error = wlc::getError();
-				if(wlc::errorIs(wlc::WOULD_BLOCK, error)) { // Temporary unavailable
-					timer.wait(100);
+				if(wlc::errorIs(wlc::WOULD_BLOCK, error)) // Everything read
+					return true;
+				if(error == EINTR)
 					continue;
-				}
-				else if(wlc::errorIs(wlc::REFUSED_CONNECT, error)) { // Server connection forcibly closed
-					break;
-				}
-				else {
+				
+				if(!wlc::errorIs(wlc::REFUSED_CONNECT, error)) { // Not server connection forcibly closed
 					std::lock_guard<std::mutex> lockCbk(_mutCbk);
 					if(_cbkError) 
 						_cbkError(Error(error, "TCP receive Error"));
-					break;
+					return false;
 				}
 			}
 			
-			if(recv_len == 0) {
-				std::lock_guard<std::mutex> lockCbk(_mutCbk);
-				if(_cbkError) 
-					_cbkError(Error(wlc::REFUSED_CONNECT, "Server disconnected"));
-				break;
-			}
-			
-			// Read messages
-			if(recv_len < 14) // Bad message
-				continue;
-			
-			for(const Message& message :  MessageManager::readMessages(buf, recv_len)) {
-				if(!_isConnected) {
-					if(message.code() == Message::HANDSHAKE) {
-						std::string strMessage = message.str();
+			std::lock_guard<std::mutex> lockCbk(_mutCbk);
+			if(_cbkError) 
+				_cbkError(Error(wlc::REFUSED_CONNECT, "Server disconnected"));
+			return false;
+		}
+	}
+	
+	// Messages may be cut between two reads : the end is kept for the next one
+	void _onTcpData(const char* buf, size_t len) {
+		auto onMessage = [&](const MessageView& message) {
+			if(!_isConnected) {
+				if(message.code() == Message::HANDSHAKE) {
+					if(message.is("udp?")) { 		// UDP needed ?
+						sendData(Message(Message::HANDSHAKE, "udp."));
+					}
+					else if(message.is("ok.")) {	// Handshake complete
+						_isConnected = true;
 						
-						if(strMessage == "udp?") { 		// UDP needed ?
-							sendData(Message(Message::HANDSHAKE, "udp."));
-						}
-						else if(strMessage == "ok.") {	// Handshake complete
-							_isConnected = true;
-							
-							std::lock_guard<std::mutex> lockCbk(_mutCbk);
-							if(_cbkConnect) 
-								_cbkConnect();
-						}
+						std::lock_guard<std::mutex> lockCbk(_mutCbk);
+						if(_cbkConnect) 
+							_cbkConnect();
 					}
 				}
-				else {
-					std::lock_guard<std::mutex> lockCbk(_mutCbk);
-					if(_cbkInfo) 
-						_cbkInfo(message);
-				}
-			} // -- End messages
-		} // -- End loop
-	} // -- End function recv tcp
+			}
+			else if(message.code() == Message::HANDSHAKE && message.str().compare(0, 6, "mcast:") == 0) {
+				_joinMulticast(message.str().substr(6));
+			}
+			else if(message.code() == Message::HANDSHAKE && message.is("mcast-")) {
+				_leaveMulticast();
+			}
+			else {
+				std::lock_guard<std::mutex> lockCbk(_mutCbk);
+				if(_cbkInfo) 
+					_cbkInfo(message);
+			}
+		};
+		
+		if(_received.empty()) {
+			const size_t read = MessageManager::readMessages(buf, len, onMessage);
+			_received.assign(buf + read, buf + len);
+		}
+		else {
+			_received.insert(_received.end(), buf, buf + len);
+			const size_t read = MessageManager::readMessages(_received.data(), _received.size(), onMessage);
+			_received.erase(_received.begin(), _received.begin() + read);
+		}
+		
+		// Not a message
+		if(_received.size() > _TCP_MAX_PENDING)
+			_received.clear();
+	}
 	
-	void _recvUdp() {
-		sockaddr_in serverAddress;
-		const int BUFFER_SIZE	= 64000;
-		char buf[BUFFER_SIZE]	= {0};
-		ssize_t recv_len 	= 0;
-		socklen_t slen(sizeof(serverAddress));
-		
-		bool buffering = false;
-		size_t sizeWaited = 0;
-		std::vector<char> msgSerializedBuffer;
-		
-		for(Timer timer; _isAlive; ) {	
-			// UDP - Receive
-			memset(buf, 0, BUFFER_SIZE);
-			
-			if ((recv_len = recvfrom(_udpSock, buf, BUFFER_SIZE, 0, (sockaddr *)&serverAddress, &slen)) == SOCKET_ERROR) {			
+	// Joined in the loop, from the invitation "group:port". Confirmed to the server, which stops the unicast copies.
+	bool _joinMulticast(const std::string& location) {
+		if(!_multicastAllowed || _multicastSock != INVALID_SOCKET)
+			return false;
+		
+		const size_t iPort = location.rfind(':');
+		if(iPort == std::string::npos)
+			return false;
+		
+		sockaddr_in address = {};
+		address.sin_family 	= AF_INET;
+		address.sin_port 	= htons(std::atoi(location.c_str() + iPort + 1));
+		if(wlc::inetPton(location.substr(0, iPort).c_str(), &address.sin_addr) != 1)
+			return false;
+		
+		SOCKET sock = socket(PF_INET, SOCK_DGRAM, IPPROTO_UDP);
+		if(sock == INVALID_SOCKET)
+			return false;
+		
+		// Several clients on one machine share the port
+		int reuse = 1;
+		setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, (const char*)&reuse, sizeof(reuse));
+		
+		// Linux : bound to the group, or it would get the datagrams of every group joined on this port
+		sockaddr_in local = address;
+#ifdef _WIN32
+		local.sin_addr.s_addr = INADDR_ANY;
+#endif
+		
+		struct ip_mreq membership;
+		membership.imr_multiaddr 		= address.sin_addr;
+		membership.imr_interface.s_addr = INADDR_ANY;
+		
+		if(bind(sock, (sockaddr*)&local, sizeof(local)) == SOCKET_ERROR 
+			|| setsockopt(sock, IPPROTO_IP, IP_ADD_MEMBERSHIP, (const char*)&membership, sizeof(membership)) == SOCKET_ERROR 
+			|| wlc::setNonBlocking(sock, true) < 0) 
+		{
+			{
+				std::lock_guard<std::mutex> lockCbk(_mutCbk);
+				if(_cbkError) 
+					_cbkError(Error(wlc::getError(), "Multicast join Error: " + location));
+			}
+			wlc::closeSocket(sock);
+			return false;
+		}
+		wlc::setReceiveBuffer(sock, 4 << 20); // Best effort
+		
+		_multicastSock = sock;
+#ifdef URING_AVAILABLE
+		if(_uring)
+			_armRecv(_OP_MULTICAST);
+#endif
+		
+		sendInfo(Message(Message::HANDSHAKE, "mcast."));
+		return true;
+	}
+	
+	// Asked by the server, in the loop : the group has streams this client doesn't want (anymore), they come by unicast
+	void _leaveMulticast() {
+		if(_multicastSock == INVALID_SOCKET)
+			return;
+		
+#ifdef URING_AVAILABLE
+		// Its receive ends with the socket : canceled first, the completion is ignored
+		if(_uring) {
+			struct io_uring_sqe* sqe = _ring.getSqe();
+			if(sqe)
+				Uring::prepare(sqe, IORING_OP_ASYNC_CANCEL, -1, (const void*)(uintptr_t)_OP_MULTICAST, 0, _OP_CANCEL);
+		}
+#endif
+		wlc::closeSocket(_multicastSock); // Leaves the group
+		_multicastSock = INVALID_SOCKET;
+	}
+	
+	// Until nothing is left : on Linux a whole burst by recvmmsg
+	bool _readUdp(SOCKET sock) {
+		for(;;) {
+#ifdef __linux__
+			const int nReceived = recvmmsg(sock, _datagrams, _UDP_BATCH, MSG_DONTWAIT, nullptr);
+#else
+			const int length = recvfrom(sock, _udpBuffer.get(), (int)_UDP_SLOT_SIZE, 0, nullptr, nullptr);
+			const int nReceived = length == SOCKET_ERROR ? SOCKET_ERROR : 1;
+#endif
+			if(nReceived == SOCKET_ERROR) {
 				// What kind of error ?
 				int error = wlc::getError();
-				if(wlc::errorIs(wlc::WOULD_BLOCK, error) || wlc::errorIs(wlc::INVALID_ARG, error)) {
-					timer.wait(buffering ? 1 : 100);
+				if(wlc::errorIs(wlc::WOULD_BLOCK, error) || wlc::errorIs(wlc::INVALID_ARG, error)) // Everything read
+					return true;
+				if(error == EINTR || wlc::errorIs(wlc::MSG_SIZE, error)) // Message too big
 					continue;
-				}
-				else if(wlc::errorIs(wlc::REFUSED_CONNECT, error)) { // Forcibly disconnected
-					break;
-				}
-				else if(wlc::errorIs(wlc::MSG_SIZE, error)) { // Message too big
-					continue;
-				}
-				else {
-					std::lock_guard<std::mutex> lockCbk(_mutCbk);
-					if(_cbkError) 
-						_cbkError(Error(error, "UDP receive Error"));
-					break;
-				}
+				if(wlc::errorIs(wlc::REFUSED_CONNECT, error)) // Forcibly disconnected
+					return false;
+				
+				std::lock_guard<std::mutex> lockCbk(_mutCbk);
+				if(_cbkError) 
+					_cbkError(Error(error, "UDP receive Error"));
+				return false;
 			}
 			
-			// Read message
-			if(!buffering && recv_len < 14) // Bad message
-				continue;
+#ifdef __linux__
+			for(int i = 0; i < nReceived; i++)
+				_onDatagram((const char*)_udpSlots[i].iov_base, (size_t)_datagrams[i].msg_len);
 			
-			// Get only header (14bytes)
-			if(recv_len == 14) {
-				Message message(buf, recv_len); // Will only read the header
-				
-				sizeWaited 				= (size_t)message.length();
-				msgSerializedBuffer	= std::vector<char>(buf, buf+14);
-				buffering = true;
-
-				continue;
+			if(nReceived < (int)_UDP_BATCH) // Drained
+				return true;
+#else
+			_onDatagram(_udpBuffer.get(), (size_t)length);
+#endif
+		}
+	}
+	
+#ifdef URING_AVAILABLE
+	// ------------ io_uring loop : receives armed once, the kernel fills its buffers ------------
+	void _loopUring() {
+		_idLoop = std::this_thread::get_id();
+		
+		while(_isAlive) {
+			if(_ring.submit(1) == -1 && errno != EINTR && errno != EBUSY && errno != EAGAIN) {
+				std::lock_guard<std::mutex> lockCbk(_mutCbk);
+				if(_cbkError) 
+					_cbkError(Error(wlc::getError(), "Client loop Error"));
+				break;
+			}
+			
+			_ring.reap([&](const struct io_uring_cqe& cqe) {
+				if(_isAlive && !_onCompletion(cqe))
+					_isAlive = false;
+			});
+		}
+		
+		// Forcibly disconnected
+		_isConnected = false;
+		_isAlive = false;
+	}
+	
+	// False when the server is gone, or to stop
+	bool _onCompletion(const struct io_uring_cqe& cqe) {
+		const bool more = (cqe.flags & IORING_CQE_F_MORE) != 0;
+		
+		if(cqe.user_data == _OP_STOP)
+			return false;
+		
+		// Multicast left : what it still received is dropped
+		if(cqe.user_data == _OP_CANCEL || (cqe.user_data == _OP_MULTICAST && _multicastSock == INVALID_SOCKET)) {
+			if(Uring::BufferRing::hasBuffer(cqe))
+				_udpBuffers.give(Uring::BufferRing::idOf(cqe));
+			return true;
+		}
+		
+		if(cqe.user_data == _OP_TCP) {
+			if(cqe.res > 0) {
+				const uint16_t idBuffer = Uring::BufferRing::idOf(cqe);
+				_onTcpData(_tcpBuffers.buffer(idBuffer), (size_t)cqe.res);
+				_tcpBuffers.give(idBuffer);
+				return more || _armRecv(_OP_TCP);
 			}
 			
-			if(!buffering) { // Already full message : send it
-				Message message(buf, recv_len);
+			// Every buffer in use : the data waits in the socket
+			if(cqe.res == -ENOBUFS)
+				return _armRecv(_OP_TCP);
+			
+			std::lock_guard<std::mutex> lockCbk(_mutCbk);
+			if(_cbkError) {
+				if(cqe.res == 0 || cqe.res == -ECONNRESET || cqe.res == -ECONNREFUSED)
+					_cbkError(Error(wlc::REFUSED_CONNECT, "Server disconnected"));
+				else
+					_cbkError(Error(-cqe.res, "TCP receive Error"));
+			}
+			return false;
+		}
+		
+		// Udp, or multicast
+		if(cqe.res >= 0 && Uring::BufferRing::hasBuffer(cqe)) {
+			const uint16_t idBuffer = Uring::BufferRing::idOf(cqe);
+			const char* buf = _udpBuffers.buffer(idBuffer);
+			
+			struct io_uring_recvmsg_out out;
+			memcpy(&out, buf, sizeof(out));
+			if(!(out.flags & MSG_TRUNC))
+				_onDatagram(buf + sizeof(out), out.payloadlen);
+			_udpBuffers.give(idBuffer);
+			
+			if(out.flags & MSG_TRUNC) { // Datagram too big for the kernel buffers
+				std::lock_guard<std::mutex> lockCbk(_mutCbk);
+				if(_cbkError) 
+					_cbkError(Error(wlc::MSG_SIZE, "UDP receive Error: datagram too big, dropped"));
+			}
+		}
+		else if(cqe.res == -ECONNREFUSED) { // Forcibly disconnected
+			return false;
+		}
+		else if(cqe.res < 0 && cqe.res != -ENOBUFS) {
+			std::lock_guard<std::mutex> lockCbk(_mutCbk);
+			if(_cbkError) 
+				_cbkError(Error(-cqe.res, "UDP receive Error"));
+			return false;
+		}
+		
+		return more || _armRecv(cqe.user_data);
+	}
+	
+	bool _armRecv(uint64_t op) {
+		struct io_uring_sqe* sqe = _ring.getSqe();
+		if(!sqe)
+			return false;
+		
+		// Udp : recvmsg to see the truncated datagrams
+		if(op == _OP_UDP || op == _OP_MULTICAST) {
+			Uring::prepare(sqe, IORING_OP_RECVMSG, (int)(op == _OP_UDP ? _udpSock : _multicastSock), &_udpHeader, 1, op);
+			sqe->buf_group = _udpBuffers.group();
+		}
+		else {
+			Uring::prepare(sqe, IORING_OP_RECV, (int)_tcpSock, nullptr, 0, op);
+			sqe->buf_group = _tcpBuffers.group();
+		}
+		sqe->flags 	= IOSQE_BUFFER_SELECT;
+		sqe->ioprio = IORING_RECV_MULTISHOT;
+		return true;
+	}
+	
+	bool _startUring() {
+		if(!_uringWanted)
+			return false;
+		
+		if(!_ring.init(_URING_ENTRIES) 
+			|| !_tcpBuffers.init(_ring, _BUFFERS_TCP, _URING_TCP_BUFFERS, (uint32_t)_TCP_BUFFER_SIZE)
+			|| !_udpBuffers.init(_ring, _BUFFERS_UDP, _URING_UDP_BUFFERS, (uint32_t)(sizeof(struct io_uring_recvmsg_out) + _URING_UDP_SIZE))) 
+		{
+			_stopUring();
+			return false;
+		}
+		
+		memset(&_udpHeader, 0, sizeof(_udpHeader));
+		
+		struct io_uring_sqe* sqe = _ring.getSqe();
+		Uring::prepare(sqe, IORING_OP_POLL_ADD, _stopFd, nullptr, 0, _OP_STOP);
+		sqe->poll32_events = POLLIN;
+		_armRecv(_OP_TCP);
+		_armRecv(_OP_UDP);
+		
+		// Multishot refused right away (kernel older than 6.0) : poll instead
+		bool refused = _ring.submit() == -1;
+		_ring.reap([&](const struct io_uring_cqe& cqe) {
+			if(cqe.res == -EINVAL)
+				refused = true;
+			else if(!refused)
+				_onCompletion(cqe);
+		});
+		
+		if(refused) {
+			_stopUring();
+			return false;
+		}
+		
+		_uring = true;
+		_pLoop = std::make_shared<std::thread>(&Client::_loopUring, this);
+		return true;
+	}
+	void _stopUring() {
+		_tcpBuffers.release();
+		_udpBuffers.release();
+		_ring.release();
+		_uring = false;
+	}
+#endif
+	
+	void _onDatagram(const char* buf, size_t len) {
+		// Part of a big message, in any order
+		if(Fragment::isFragment(buf, len)) {
+			_mutFragments.lock();
+			bool complete = _reassembler.push(buf, len, _msgSerialized);
+			_mutFragments.unlock();
+			
+			if(complete) {
+				MessageView message(_msgSerialized.data(), _msgSerialized.size());
 				
 				std::lock_guard<std::mutex> lockCbk(_mutCbk);
 				if(_cbkData) 
 					_cbkData(message);
 			}
-			else { // Buffering
-				msgSerializedBuffer.insert(msgSerializedBuffer.end(), buf, buf+recv_len);
+			return;
+		}
+		
+		// Read message
+		if(!_buffering && len < 14) // Bad message
+			return;
+		
+		// Get only header (14bytes)
+		if(len == 14) {
+			MessageView message(buf, len); // Only the header
+			
+			_sizeWaited 			= message.length();
+			_msgSerializedBuffer	= std::vector<char>(buf, buf+14);
+			_buffering = true;
+			return;
+		}
+		
+		if(!_buffering) { // Already full message : send it
+			MessageView message(buf, len);
+			
+			std::lock_guard<std::mutex> lockCbk(_mutCbk);
+			if(_cbkData) 
+				_cbkData(message);
+		}
+		else { // Buffering
+			_msgSerializedBuffer.insert(_msgSerializedBuffer.end(), buf, buf+len);
+			
+			// Finally get the full message : send it
+			if(_sizeWaited <= _msgSerializedBuffer.size()) {
+				MessageView message(_msgSerializedBuffer.data(), _msgSerializedBuffer.size());
+				_buffering = false;
 				
-				// Finally get the full message : send it
-				if(sizeWaited <= msgSerializedBuffer.size()) {
-					Message message(msgSerializedBuffer.data(), msgSerializedBuffer.size());
-					buffering = false;
-					
-					std::lock_guard<std::mutex> lockCbk(_mutCbk);
-					if(_cbkData) 
-						_cbkData(message);
-					
-				}
+				std::lock_guard<std::mutex> lockCbk(_mutCbk);
+				if(_cbkData) 
+					_cbkData(message);
 			}
 		}
-		
-		// Forcibly disconnected
-		if(_isConnected)
-			disconnect();
 	}
 
 private:
+	// Constants
+	static const size_t _UDP_BATCH 		= 32;
+	static const size_t _UDP_SLOT_SIZE 	= 65536;	// Any datagram
+	static const size_t _TCP_BUFFER_SIZE 	= 2048;
+	static const size_t _TCP_MAX_PENDING 	= 64 << 10;	// Longer than any message : the stream is lost
+	static const int _POLL_TIMEOUT_MS 		= 100; // Windows : no eventfd, disconnect() is seen at the timeout
+	static const unsigned int _URING_ENTRIES 	= 16;
+	static const uint16_t _URING_TCP_BUFFERS 	= 16; 	// Power of 2
+	static const uint16_t _URING_UDP_BUFFERS 	= 256; 	// Power of 2 : a burst of fragments
+	static const size_t _URING_UDP_SIZE 		= 2048;	// Datagrams of the server (Fragment::DATAGRAM_SIZE at most). Bigger : dropped, reported
+	static const uint16_t _BUFFERS_TCP 			= 0; 	// Buffer rings ids
+	static const uint16_t _BUFFERS_UDP 			= 1;
+	
+	// io_uring operations
+	enum _UringOp {
+		_OP_TCP = 1, _OP_UDP, _OP_MULTICAST, _OP_STOP, _OP_CANCEL
+	};
+	
 	// Members
 	std::atomic<bool> _isConnected;
 	std::atomic<bool> _isAlive;		// Control threads
 	
 	SOCKET _udpSock;
 	SOCKET _tcpSock;
+	SOCKET _multicastSock;	// Once joined
+	std::atomic<bool> _multicastAllowed;
 	sockaddr_in _address;
 	
 	// Callbacks
 	mutable std::mutex _mutCbk;
 	std::function<void(const Error& error)> _cbkError;
-	std::function<void(const Message& message)> _cbkInfo;
-	std::function<void(const Message& message)> _cbkData;
+	std::function<void(const MessageView& message)> _cbkInfo;
+	std::function<void(const MessageView& message)> _cbkData;
 	std::function<void(void)> _cbkConnect;
 	
-	// Threads
-	std::shared_ptr<std::thread> _pRecvTcp;
-	std::shared_ptr<std::thread> _pRecvUdp;
+	// Thread
+	std::shared_ptr<std::thread> _pLoop;
+	std::atomic<std::thread::id> _idLoop; // Set by the loop itself : its callbacks may come before _pLoop
+	int _stopFd;	// eventfd (Linux)
+	
+	// io_uring loop (Linux 6.0)
+	std::atomic<bool> _uringWanted;
+	std::atomic<bool> _uring;
+#ifdef URING_AVAILABLE
+	Uring _ring;
+	Uring::BufferRing _tcpBuffers;
+	Uring::BufferRing _udpBuffers;
+	struct msghdr _udpHeader; 	// Receives : no address, no control
+#endif
+	
+	// Receiving
+	std::vector<char> _received;			// Start of a TCP message not complete yet
+	std::unique_ptr<char[]> _udpBuffer;	// _UDP_BATCH slots
+#ifdef __linux__
+	struct iovec _udpSlots[_UDP_BATCH];
+	struct mmsghdr _datagrams[_UDP_BATCH];
+#endif
+	
+	// Legacy : header sent alone, then the content
+	bool _buffering = false;
+	size_t _sizeWaited = 0;
+	std::vector<char> _msgSerializedBuffer;
+	std::vector<char> _msgSerialized;	// Last message reassembled
 	
+	// Fragmented messages
+	mutable std::mutex _mutFragments;
+	Reassembler _reassembler;
 };
\ No newline at end of file
@@ -0,0 +1,267 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <map>
+#include <utility>
+#include <algorithm>
+
+#include "Message.hpp"
+
+// ------------ Fragment : Messages too big for one datagram, split at the application level ------------
+// Datagram : [code 4 = FRAGMENT][stream 2][sequence 4][index 2][count 2][total 4][offset 4][chunk]
+// Every datagram fits in the MTU : a lost packet only loses its fragment, never a 64KB IP datagram.
+class Fragment {
+public:
+	static const size_t HEADER_SIZE 	= 22;
+	static const size_t DATAGRAM_SIZE 	= 1400;	// Ethernet and Wi-Fi, with room for IP/UDP and tunnels
+	static const size_t CHUNK_SIZE 		= DATAGRAM_SIZE - HEADER_SIZE;
+	static const size_t MAX_TOTAL 		= 64 << 20;	// Refuse corrupted headers before allocating
+
+	struct Header {
+		uint16_t stream 	= 0;	// Message code
+		uint32_t sequence 	= 0;	// Message number
+		uint16_t index 		= 0;
+		uint16_t count 		= 0;
+		uint32_t total 		= 0;	// Serialized message length
+		uint32_t offset 	= 0;	// Of the chunk in the serialized message
+	};
+
+	// One datagram : header and views on the message. The chunk may start in the message header, then continue in the content.
+	struct Piece {
+		char header[HEADER_SIZE];
+		const char* data[2];
+		size_t length[2];
+	};
+
+	// Split a serialized message. Needs more than one datagram : see needed()
+	static std::vector<Piece> split(const Message& msg, uint32_t sequence) {
+		std::vector<Piece> pieces;
+
+		const size_t total = msg.length();
+		const size_t count = (total + CHUNK_SIZE - 1) / CHUNK_SIZE;
+		if(!msg.isValide() || count == 0 || count > UINT16_MAX)
+			return pieces;
+
+		pieces.resize(count);
+		for(size_t i = 0; i < count; i++) {
+			Header header;
+			header.stream 	= static_cast<uint16_t>(msg.code() & 0xFFFF);
+			header.sequence = sequence;
+			header.index 	= static_cast<uint16_t>(i);
+			header.count 	= static_cast<uint16_t>(count);
+			header.total 	= static_cast<uint32_t>(total);
+			header.offset 	= static_cast<uint32_t>(i * CHUNK_SIZE);
+
+			writeHeader(header, pieces[i].header);
+			
+			// [offset, offset + length[ in [message header][content]
+			const size_t offset = header.offset;
+			const size_t length = (i + 1 < count) ? CHUNK_SIZE : total - offset;
+			Piece& piece(pieces[i]);
+			
+			if(offset < Message::HEADER_SIZE) {
+				piece.data[0] 	= msg.header() + offset;
+				piece.length[0] = std::min(length, Message::HEADER_SIZE - offset);
+				piece.data[1] 	= msg.content();
+				piece.length[1] = length - piece.length[0];
+			}
+			else {
+				piece.data[0] 	= msg.content() + (offset - Message::HEADER_SIZE);
+				piece.length[0] = length;
+				piece.data[1] 	= nullptr;
+				piece.length[1] = 0;
+			}
+		}
+
+		return pieces;
+	}
+	static bool needed(const Message& msg) {
+		return msg.length() > DATAGRAM_SIZE;
+	}
+
+	static bool isFragment(const char* data, const size_t len) {
+		return len > HEADER_SIZE && _read(data, 4) == Message::FRAGMENT;
+	}
+	static bool readHeader(const char* data, const size_t len, Header& header) {
+		if(!isFragment(data, len))
+			return false;
+
+		header.stream 	= static_cast<uint16_t>(_read(data + 4, 2));
+		header.sequence = static_cast<uint32_t>(_read(data + 6, 4));
+		header.index 	= static_cast<uint16_t>(_read(data + 10, 2));
+		header.count 	= static_cast<uint16_t>(_read(data + 12, 2));
+		header.total 	= static_cast<uint32_t>(_read(data + 14, 4));
+		header.offset 	= static_cast<uint32_t>(_read(data + 18, 4));
+
+		return header.index < header.count && header.total <= MAX_TOTAL && header.offset + (len - HEADER_SIZE) <= header.total;
+	}
+	static void writeHeader(const Header& header, char* out) {
+		_write(out, 	 Message::FRAGMENT, 4);
+		_write(out + 4,  header.stream, 	2);
+		_write(out + 6,  header.sequence, 	4);
+		_write(out + 10, header.index, 		2);
+		_write(out + 12, header.count, 		2);
+		_write(out + 14, header.total, 		4);
+		_write(out + 18, header.offset, 	4);
+	}
+
+private:
+	// Little endian, as the messages
+	static uint64_t _read(const char* data, int nBytes) {
+		uint64_t value = 0;
+		for(int i = 0; i < nBytes; i++)
+			value |= static_cast<uint64_t>(static_cast<unsigned char>(data[i])) << (8*i);
+		return value;
+	}
+	static void _write(char* out, uint64_t value, int nBytes) {
+		for(int i = 0; i < nBytes; i++)
+			out[i] = static_cast<char>((value >> (8*i)) & 0xFF);
+	}
+};
+
+// ------------ Reassembler : Fragments in any order back to messages ------------
+// A message is forgotten when it's too old : a newer one of the same stream is complete, or too many are pending.
+class Reassembler {
+public:
+	struct Stats {
+		uint64_t completed 	= 0;	// Messages rebuilt
+		uint64_t incomplete = 0;	// Messages forgotten with missing fragments
+		uint64_t duplicates = 0;	// Fragments received twice
+		uint64_t invalid 	= 0;	// Fragments not matching their message
+		uint64_t late 		= 0;	// Fragments of messages older than the last completed
+		uint64_t restarts 	= 0;	// Streams numbered again from far behind (sender restarted)
+	};
+
+	explicit Reassembler(size_t maxPending = 8) : _maxPending(maxPending) {
+	}
+
+	// Return true when the message is complete, then 'message' is the serialized message
+	bool push(const char* data, const size_t len, std::vector<char>& message) {
+		Fragment::Header header;
+		if(!Fragment::readHeader(data, len, header)) {
+			_stats.invalid++;
+			return false;
+		}
+
+		const _Key key(header.stream, header.sequence);
+		auto itPending = _pending.find(key);
+
+		// Older than the last message completed on this stream : late, or the sender started again from far behind
+		auto itLast = _lastCompleted.find(header.stream);
+		if(itPending == _pending.end() && itLast != _lastCompleted.end() && _isOlder(header.sequence, itLast->second + 1)) {
+			if(itLast->second - header.sequence <= _MAX_LATE) {
+				_stats.late++;
+				return false;
+			}
+			
+			_stats.restarts++;
+			_lastCompleted.erase(itLast);
+			_dropStream(header.stream);
+		}
+
+		if(itPending == _pending.end()) {
+			_evict(header.stream);
+			itPending = _pending.insert(std::make_pair(key, _Pending(header))).first;
+		}
+
+		_Pending& pending(itPending->second);
+		if(pending.total != header.total || pending.received.size() != header.count) {
+			_stats.invalid++;
+			return false;
+		}
+		if(pending.received[header.index]) {
+			_stats.duplicates++;
+			return false;
+		}
+
+		memcpy(&pending.data[header.offset], data + Fragment::HEADER_SIZE, len - Fragment::HEADER_SIZE);
+		pending.received[header.index] = true;
+		if(--pending.missing > 0)
+			return false;
+
+		// Complete : the older ones of this stream won't be
+		message.swap(pending.data);
+		_pending.erase(itPending);
+		_lastCompleted[header.stream] = header.sequence;
+		_dropOlder(header.stream, header.sequence);
+
+		_stats.completed++;
+		return true;
+	}
+
+	const Stats& getStats() const {
+		return _stats;
+	}
+	size_t pending() const {
+		return _pending.size();
+	}
+
+private:
+	typedef std::pair<uint16_t, uint32_t> _Key;
+
+	struct _Pending {
+		explicit _Pending(const Fragment::Header& header) :
+			total(header.total), data(header.total), received(header.count, false), missing(header.count)
+		{
+		}
+
+		uint32_t total;
+		std::vector<char> data;
+		std::vector<bool> received;
+		size_t missing;
+	};
+
+	// Sequences wrap around
+	static bool _isOlder(uint32_t a, uint32_t b) {
+		return static_cast<int32_t>(a - b) < 0;
+	}
+
+	void _dropOlder(uint16_t stream, uint32_t sequence) {
+		for(auto it = _pending.begin(); it != _pending.end(); ) {
+			if(it->first.first == stream && _isOlder(it->first.second, sequence)) {
+				_stats.incomplete++;
+				it = _pending.erase(it);
+			}
+			else {
+				++it;
+			}
+		}
+	}
+	void _dropStream(uint16_t stream) {
+		for(auto it = _pending.begin(); it != _pending.end(); ) {
+			if(it->first.first == stream) {
+				_stats.incomplete++;
+				it = _pending.erase(it);
+			}
+			else {
+				++it;
+			}
+		}
+	}
+	void _evict(uint16_t stream) {
+		size_t count = 0;
+		auto itOldest = _pending.end();
+		for(auto it = _pending.begin(); it != _pending.end(); ++it) {
+			if(it->first.first != stream)
+				continue;
+
+			count++;
+			if(itOldest == _pending.end() || _isOlder(it->first.second, itOldest->first.second))
+				itOldest = it;
+		}
+
+		if(count >= _maxPending && itOldest != _pending.end()) {
+			_stats.incomplete++;
+			_pending.erase(itOldest);
+		}
+	}
+
+	static const uint32_t _MAX_LATE = 1024;	// Messages : further behind, no datagram is that late
+	
+	size_t _maxPending;	// By stream
+	std::map<_Key, _Pending> _pending;
+	std::map<uint16_t, uint32_t> _lastCompleted;
+	Stats _stats;
+};
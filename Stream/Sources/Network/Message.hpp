@@ -6,9 +6,82 @@
 #include <vector>
 #include <iostream>
 #include <map>
+#include <memory>
 
 #include "../Timer.hpp"
 
+// --------- MessageView ------------
+// Serialized message read where it is : nothing copied nor allocated, valid as long as the buffer.
+class MessageView {
+public:
+	// - Constructor
+	MessageView(const char* buffer, const size_t len) : _buffer(nullptr), _len(0), _code(0), _size(0), _time(0) {
+		if(len < 14)
+			return;
+		
+		_buffer = buffer;
+		_len 	= len;
+		_code 	= static_cast<unsigned int>(_read(buffer, 4));
+		_size 	= static_cast<unsigned int>(_read(buffer + 4, 4));
+		_time 	= _read(buffer + 8, 6);
+	}
+	
+	// - Getters
+	const unsigned int code() const {
+		return _code;
+	}
+	const unsigned int size() const {
+		return _size;
+	}
+	const uint64_t timestamp() const {
+		return _time;
+	}
+	const size_t length() const {
+		return static_cast<size_t>(_size) + 14;
+	}
+	const char* header() const {
+		return _buffer;
+	}
+	const char* content() const {
+		return isValide() ? _buffer + 14 : nullptr;
+	}
+	// Copy of the content. Text compared in place : see is()
+	const std::string str() const {
+		if(!isValide())
+			return "";
+		
+		return std::string(content(), _size);
+	}
+	bool is(const char* text) const {
+		const size_t len = strlen(text);
+		return isValide() && len == _size && memcmp(content(), text, len) == 0;
+	}
+	
+	// Header read, the buffer may be too short for the content
+	bool isComplete() const {
+		return _buffer != nullptr && _len >= length();
+	}
+	bool isValide() const {
+		return isComplete() && _size > 0;
+	}
+	
+private:
+	// Little endian
+	static uint64_t _read(const char* data, int nBytes) {
+		uint64_t value = 0;
+		for(int i = 0; i < nBytes; i++)
+			value |= static_cast<uint64_t>(static_cast<unsigned char>(data[i])) << (8*i);
+		return value;
+	}
+	
+	// Members
+	const char* _buffer;
+	size_t _len;
+	unsigned int _code;
+	unsigned int _size;
+	uint64_t _time;
+};
+
 class Message {
 public:
 	enum ActionCode {		
@@ -16,8 +89,13 @@ public:
 		HANDSHAKE	= (1<<2),
 		CAMERA		= (1<<3),
 		MPU			= (1<<4),
+		BUNDLE		= (1<<5),	// Frame with its imu samples
+		STILL		= (1<<6),	// Camera frame unchanged, not sent
+		FRAGMENT	= (1<<7),	// Part of a message too big for one datagram
 	};
 	
+	static const size_t HEADER_SIZE = 14;
+	
 public:
 	// - Constructors
 	// Serializator
@@ -31,10 +109,22 @@ public:
 		_serialize(code, len, buffer);
 	}
 	
+	// Payload not copied : only referenced, kept alive by 'owner' (may be null if it outlives the message)
+	Message(const ActionCode code, const char* payload, const size_t len, const std::shared_ptr<const void>& owner) :
+		_owner(owner), _payload(payload)
+	{
+		_writeHeader(code, len);
+	}
+	
 	// Unserializator
 	Message(const char* buffer, const size_t len) {
 		_unserialize(buffer, len);
 	}
+	// Own copy of a view, when the message has to outlive the buffer
+	Message(const MessageView& view) {
+		if(view.isComplete())
+			_unserialize(view.header(), view.length());
+	}
 	
 	// - Getters
 	const unsigned int code() const {
@@ -49,34 +139,60 @@ public:
 	const unsigned int length() const {
 		return _size+14;
 	}
+	// [CODE][SIZE][TIME], always 14 bytes
+	const char* header() const {
+		return _header;
+	}
 	const char* content() const {
 		if(isValide())
-			return &_dataSerialized[14];
+			return _payload ? _payload : &_dataSerialized[14];
 		else
 			return nullptr;
 	}
+	// Header and content in one buffer. Referenced payload : copied at the first call.
 	const char* data() const {
-		if(isValide())
-			return &_dataSerialized[0];
-		else
+		if(!isValide())
 			return nullptr;
+		
+		if(_payload && _dataSerialized.empty()) {
+			_dataSerialized.resize(14 + static_cast<size_t>(_size));
+			memcpy(&_dataSerialized[0], _header, 14);
+			memcpy(&_dataSerialized[14], _payload, static_cast<size_t>(_size));
+		}
+		return &_dataSerialized[0];
 	}
 	const std::string str() const {
 		if(!isValide())
 			return "";
 		
-		return std::string(&_dataSerialized[14], _size);
+		return std::string(content(), _size);
+	}
+	
+	// Null when the message has its own copy of the payload
+	const std::shared_ptr<const void>& owner() const {
+		return _owner;
 	}
 	
 	bool isValide() const {
 		// Message should be at least 14 to be valid
-		return (_dataSerialized.size() > 14);
+		return _payload ? _size > 0 : (_dataSerialized.size() > 14);
 	}
 	
 private:
 	// - Methods 
 	// Create a message [[CODE] [SIZE_MSG] [MSG]]
 	void _serialize(const ActionCode code, const size_t size, const char* pMessage) {
+		_writeHeader(code, size);
+		
+		// Create string
+		_dataSerialized.resize(static_cast<size_t>(14+_size), '\0');
+		
+		// Copy code 
+		memcpy(&_dataSerialized[0], _header, 14);
+		memcpy(&_dataSerialized[14], pMessage, static_cast<size_t>(_size));
+	}
+	
+	void _writeHeader(const ActionCode code, const size_t size) {
 		_time = Timer::timestampMs();
 		_code = static_cast<unsigned int>(code);
 		_size = static_cast<unsigned int>(size);
@@ -103,14 +219,9 @@ private:
 			static_cast<unsigned char>((_time & 0xFF0000000000) >> 40),
 		};
 		
-		// Create string
-		_dataSerialized.resize(static_cast<size_t>(14+_size), '\0');
-		
-		// Copy code 
-		memcpy(&_dataSerialized[0], byteCode, 4);
-		memcpy(&_dataSerialized[4], byteSize, 4);
-		memcpy(&_dataSerialized[8], byteTime, 6);
-		memcpy(&_dataSerialized[14], pMessage, static_cast<size_t>(_size));
+		memcpy(&_header[0], byteCode, 4);
+		memcpy(&_header[4], byteSize, 4);
+		memcpy(&_header[8], byteTime, 6);
 	}
 	
 	void _unserialize(const char* buffer, const size_t len) {
@@ -137,14 +248,19 @@ private:
 			(static_cast<uint64_t>(static_cast<unsigned char>(buffer[12])) << 32) +
 			(static_cast<uint64_t>(static_cast<unsigned char>(buffer[13])) << 40);
 		
+		memcpy(_header, buffer, 14);
 		_dataSerialized = std::vector<char>(buffer, buffer+len);
 	}
 	
 	// Members
-	unsigned int _code;
-	unsigned int _size;
-	uint64_t _time;
-	std::vector<char> _dataSerialized;
+	unsigned int _code = 0;
+	unsigned int _size = 0;
+	uint64_t _time = 0;
+	char _header[14] = {0};
+	
+	mutable std::vector<char> _dataSerialized;	// Copied messages : header and content
+	std::shared_ptr<const void> _owner;			// Referenced messages : content kept alive
+	const char* _payload = nullptr;
 };
 
 // --------- Error ------------
@@ -298,28 +414,30 @@ private:
 // --------- Manager ------------
 class MessageManager {
 public:
-	static std::vector<Message> readMessages(const char* buffer, const size_t len) {
-		std::vector<Message> messages;
+	// Call onMessage(const MessageView&) for each message in the buffer : no copy, no allocation.
+	// Return the bytes read, an incomplete message at the end is left.
+	template<typename Callback>
+	static size_t readMessages(const char* buffer, const size_t len, const Callback& onMessage) {
+		size_t offset = 0;
 		
-		unsigned int offset = 0;
-		unsigned int limit = (unsigned int)len;
-		
-		while(offset + 14 <= limit) {
-			// Read size
-			unsigned int size = 
-				(static_cast<unsigned int>(static_cast<unsigned char>(buffer[offset+4])) << 0)  +
-				(static_cast<unsigned int>(static_cast<unsigned char>(buffer[offset+5])) << 8)  +
-				(static_cast<unsigned int>(static_cast<unsigned char>(buffer[offset+6])) << 16) +
-				(static_cast<unsigned int>(static_cast<unsigned char>(buffer[offset+7])) << 24);
-				
-			// Create message
-			if(offset + size + 14 <= limit)
-				messages.push_back(Message(buffer + offset, size + 14));
+		while(offset + 14 <= len) {
+			MessageView view(buffer + offset, len - offset);
+			if(!view.isComplete())
+				break;
 			
-			// Increase offset
-			offset += (14 + size);
+			onMessage(view);
+			offset += view.length();
 		}
 		
+		return offset;
+	}
+	
+	static std::vector<Message> readMessages(const char* buffer, const size_t len) {
+		std::vector<Message> messages;
+		readMessages(buffer, len, [&messages](const MessageView& view) {
+			messages.push_back(Message(view));
+		});
+		
 		return messages;
 	}
 };
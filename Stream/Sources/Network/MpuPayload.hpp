@@ -0,0 +1,145 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// ------------ MpuPayload : Imu samples of a Message::MPU, raw and packed ------------
+// Payload : [version 1][sensor 1][count 2][timestamp 8][period 4][accel scale 4][gyro scale 4][temperature scale 4][temperature offset 4][samples: [7 x int16]...]
+// Sample i was taken at timestamp + i * period (mus). Values in physical units : raw * scale (+ offset for the temperature).
+// The text payload ("timestamp=...|") starts with a letter, never with the version : isBinary() tells them apart.
+class MpuPayload {
+public:
+	static const uint8_t VERSION 		= 1;
+	static const size_t HEADER_SIZE 	= 32;
+	static const size_t SAMPLE_SIZE 	= 14;
+	static const size_t MAX_SAMPLES 	= 4096;	// Refuse corrupted headers before allocating
+
+	struct Header {
+		uint8_t version 		= VERSION;
+		uint8_t sensor 			= 0;	// Which imu (ex: its i2c address)
+		uint16_t count 			= 0;	// Samples following the header
+		uint64_t timestamp 		= 0;	// First sample, monotonic clock (mus)
+		uint32_t period 		= 0;	// Between two samples (mus)
+		float accelScale 		= 0.0f;	// m/s2 by LSB
+		float gyroScale 		= 0.0f;	// deg/s by LSB
+		float temperatureScale 	= 0.0f;	// celsius by LSB
+		float temperatureOffset = 0.0f;	// celsius
+	};
+
+	// As read from the sensor
+	struct Sample {
+		int16_t accel[3];
+		int16_t temperature;
+		int16_t gyro[3];
+	};
+
+	// Converted with the scales of the header
+	struct Values {
+		uint64_t timestamp;
+		double temperature;
+		double accel[3];
+		double gyro[3];
+	};
+
+public:
+	// -- Encoder : header.count is the number of samples
+	static std::string encode(const Header& header, const std::vector<Sample>& samples) {
+		std::string payload(HEADER_SIZE + samples.size() * SAMPLE_SIZE, '\0');
+		char* out = &payload[0];
+
+		_write(out, 	 VERSION, 		   	1);
+		_write(out + 1,  header.sensor, 	1);
+		_write(out + 2,  samples.size(), 	2);
+		_write(out + 4,  header.timestamp, 	8);
+		_write(out + 12, header.period, 	4);
+		_writeFloat(out + 16, header.accelScale);
+		_writeFloat(out + 20, header.gyroScale);
+		_writeFloat(out + 24, header.temperatureScale);
+		_writeFloat(out + 28, header.temperatureOffset);
+
+		out += HEADER_SIZE;
+		for(const Sample& sample : samples) {
+			const int16_t raw[7] = {sample.accel[0], sample.accel[1], sample.accel[2], sample.temperature, sample.gyro[0], sample.gyro[1], sample.gyro[2]};
+			for(int i = 0; i < 7; i++, out += 2)
+				_write(out, static_cast<uint16_t>(raw[i]), 2);
+		}
+
+		return payload;
+	}
+
+	// -- Decoder
+	static bool isBinary(const char* payload, const size_t len) {
+		return len >= HEADER_SIZE && static_cast<uint8_t>(payload[0]) == VERSION;
+	}
+	static bool decode(const char* payload, const size_t len, Header& header, std::vector<Sample>& samples) {
+		if(!isBinary(payload, len))
+			return false;
+
+		header.version 			 = VERSION;
+		header.sensor 			 = static_cast<uint8_t>(_read(payload + 1, 1));
+		header.count 			 = static_cast<uint16_t>(_read(payload + 2, 2));
+		header.timestamp 		 = _read(payload + 4, 8);
+		header.period 			 = static_cast<uint32_t>(_read(payload + 12, 4));
+		header.accelScale 		 = _readFloat(payload + 16);
+		header.gyroScale 		 = _readFloat(payload + 20);
+		header.temperatureScale  = _readFloat(payload + 24);
+		header.temperatureOffset = _readFloat(payload + 28);
+
+		if(header.count > MAX_SAMPLES || len < HEADER_SIZE + header.count * SAMPLE_SIZE)
+			return false;
+
+		samples.resize(header.count);
+		const char* in = payload + HEADER_SIZE;
+		for(Sample& sample : samples) {
+			int16_t raw[7];
+			for(int i = 0; i < 7; i++, in += 2)
+				raw[i] = static_cast<int16_t>(_read(in, 2));
+
+			sample.accel[0] 	= raw[0];
+			sample.accel[1] 	= raw[1];
+			sample.accel[2] 	= raw[2];
+			sample.temperature 	= raw[3];
+			sample.gyro[0] 		= raw[4];
+			sample.gyro[1] 		= raw[5];
+			sample.gyro[2] 		= raw[6];
+		}
+
+		return true;
+	}
+	static Values convert(const Header& header, const Sample& sample, const size_t index) {
+		Values values;
+		values.timestamp 	= header.timestamp + index * header.period;
+		values.temperature 	= sample.temperature * header.temperatureScale + header.temperatureOffset;
+		for(int i = 0; i < 3; i++) {
+			values.accel[i] = sample.accel[i] * header.accelScale;
+			values.gyro[i] 	= sample.gyro[i] * header.gyroScale;
+		}
+		return values;
+	}
+
+private:
+	// Little endian, as the messages
+	static uint64_t _read(const char* data, int nBytes) {
+		uint64_t value = 0;
+		for(int i = 0; i < nBytes; i++)
+			value |= static_cast<uint64_t>(static_cast<unsigned char>(data[i])) << (8*i);
+		return value;
+	}
+	static void _write(char* out, uint64_t value, int nBytes) {
+		for(int i = 0; i < nBytes; i++)
+			out[i] = static_cast<char>((value >> (8*i)) & 0xFF);
+	}
+	static float _readFloat(const char* data) {
+		const uint32_t bits = static_cast<uint32_t>(_read(data, 4));
+		float value = 0.0f;
+		memcpy(&value, &bits, sizeof(value));
+		return value;
+	}
+	static void _writeFloat(char* out, float value) {
+		uint32_t bits = 0;
+		memcpy(&bits, &value, sizeof(bits));
+		_write(out, bits, 4);
+	}
+};
@@ -9,10 +9,17 @@
 #include <vector>
 #include <algorithm>
 #include <functional>
+#include <condition_variable>
+#include <chrono>
+#include <deque>
+#include <map>
 
 #include "WinLinConversion.hpp"
 #include "Message.hpp"
+#include "Fragment.hpp"
+#include "Uring.hpp"
 #include "../Timer.hpp"
+#include "../Histogram.hpp"
 
 class Server {
 	// -------------- Nested struct --------------
@@ -21,9 +28,27 @@ public:
 		SOCKET id = INVALID_SOCKET;
 		clock_t lastUpdate = 0;		
 		bool connected = false;
+		bool multicast = false;		// Joined the group : gets the broadcasts there
+		uint64_t streams = 0;		// Subscribed streams, a bit by id (see subscribe())
 		sockaddr_in tcpAddress;
 		sockaddr_in udpAddress;
 	};
+	struct ZeroCopyStats {
+		uint64_t sends 		= 0;	// Sent with MSG_ZEROCOPY
+		uint64_t completed 	= 0;	// Confirmed by the kernel, buffers released
+		uint64_t copied 	= 0;	// Confirmed, but the kernel had to copy (loopback, device without scatter-gather)
+		size_t pending 		= 0;	// Messages still kept alive for the kernel
+	};
+	
+	enum QueuePolicy {
+		DropOldest,	// Queue full : forget the oldest message (imu : the next ones matter more)
+		LatestOnly	// Only the last message waits (camera : a stale frame is never sent)
+	};
+	struct QueueStats {
+		size_t queued 		= 0;	// Messages waiting right now
+		uint64_t sent 		= 0;	// Given to the network
+		uint64_t dropped 	= 0;	// Pushed out of the queue before being sent
+	};
 	
 private:
 	class ConnectedClient {
@@ -33,6 +58,7 @@ private:
 		}
 		ConnectedClient(const ConnectedClient& cc) {
 			info = cc.info;
+			received = cc.received;
 		}
 		~ConnectedClient() {
 			killThread();
@@ -54,13 +80,14 @@ private:
 		
 		ClientInfo info;
 		std::shared_ptr<std::thread> pThread;
+		std::vector<char> received;	// Start of a TCP message not complete yet
 	};
 	
 	
 	
 	// -------------- Main class --------------
 public:
-	Server() : _isConnected(false), _udpSock(INVALID_SOCKET), _tcpSock(INVALID_SOCKET) { 
+	Server() : _isConnected(false), _udpSock(INVALID_SOCKET), _tcpSock(INVALID_SOCKET), _epfd(-1), _stopFd(-1), _timerFd(-1), _uringWanted(false), _uring(false), _acceptArmed(false), _multicast(false), _sending(false), _sequence(0), _segmentOffload(false), _zeroCopy(false), _zeroCopyNext(0) { 
 		// Wait for connectAt()
 	}
 	~Server() {
@@ -70,8 +97,12 @@ public:
 	// Methods
 	void disconnect() {
 		_isConnected = false;
+		_stopSending();
 		
 		// Server disconnecting .. Send something ?		
+#ifdef __linux__
+		_stopLoop();
+#endif
 		if(_pRecvUdp && _pRecvUdp->joinable())
 			_pRecvUdp->join();
 
@@ -81,6 +112,16 @@ public:
 		wlc::closeSocket(_udpSock);
 		wlc::closeSocket(_tcpSock);
 		
+#ifdef __linux__
+		{
+			std::lock_guard<std::mutex> lockZeroCopy(_mutZeroCopy);
+			_zeroCopyPending.clear();
+			_zeroCopyNext = 0;
+		}
+#endif
+		_zeroCopy = false;
+		_multicast = false;
+		
 		// After tcp has joined : no client will be accepted, and no clients will be deleted.
 		// Therefore, just wait for the threads to finish and then delete it. (Avoid mutex deadlock)
 		for(auto& client : _clients) {
@@ -114,6 +155,12 @@ public:
 		if(_tcpSock == INVALID_SOCKET)
 			return disconnect();
 			
+#ifdef __linux__
+		// Restart while the previous connections are in TIME_WAIT
+		int reuse = 1;
+		setsockopt(_tcpSock, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+#endif
+		
 		// Bind sockets to address
 		int addrSize = sizeof(_address);
 		if(bind(_udpSock, (sockaddr *)&_address, addrSize) == SOCKET_ERROR)
@@ -133,61 +180,240 @@ public:
 		// Create threads
 		_isConnected = true;
 		
+#ifdef __linux__
+		// Before connectAt() returns : clients can connect right away
+		if(listen(_tcpSock, SOMAXCONN) == SOCKET_ERROR)
+			return disconnect();
+		
+		_stopFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+		if(_stopFd == -1 || !(_startUring() || _startLoop()))
+			return disconnect();
+#else
 		_pRecvUdp 	= std::make_shared<std::thread>(&Server::_recvUdp, this);
 		_pHandleTcp = std::make_shared<std::thread>(&Server::_handleTcp, this);
+#endif
+
+		_sending = true;
+		_pSend = std::make_shared<std::thread>(&Server::_sendQueued, this);
 	}
 	
-	// Send message with UDP
-	void sendData(const ClientInfo& client, const Message& msg) const {
-		if(msg.length() < 64000) {
-			if(sendto(_udpSock, msg.data(), (int)msg.length(), 0, (sockaddr*) &client.udpAddress, sizeof(client.udpAddress)) != (int)msg.length()) {
-				std::lock_guard<std::mutex> lockCbk(_mutCbk);
-				if(_cbkError) 
-					_cbkError(Error(wlc::getError(), "UDP send Error"));
-			}
+	// Send message with UDP. exposed : capture time of the content (mus, monotonic), for the latency at send completion
+	void sendData(const ClientInfo& client, const Message& msg, uint64_t exposed = 0) const {
+		if(_sendUdp(client, msg))
+			_recordLatency(exposed);
+	}
+	
+	// Same message to several clients : split once, and on Linux every datagram of every client in a few sendmmsg.
+	// The multicast group gets a single copy when all its members are in the list.
+	void broadcastData(const std::vector<ClientInfo>& clients, const Message& msg, uint64_t exposed = 0) const {
+		std::vector<ClientInfo> targets;
+		{
+			std::lock_guard<std::mutex> lockClients(_mutClients);
+			targets = _withMulticast(clients);
 		}
-		else {
-			unsigned int totalLengthSend = msg.length();
+		
+		if(_sendNow(targets, msg))
+			_recordLatency(exposed);
+	}
+	
+	// A stream of messages queued by client, and sent by the server thread : queueData() never waits for the network.
+	// Return its id (-1 : too many streams). LatestOnly : capacity of 1.
+	int addStream(QueuePolicy policy, size_t capacity = 1) {
+		std::lock_guard<std::mutex> lockQueues(_mutQueues);
+		if(_streams.size() >= _MAX_STREAMS)
+			return -1;
+		
+		_Stream stream;
+		stream.policy 	= policy;
+		stream.capacity = (policy == LatestOnly || capacity == 0) ? 1 : capacity;
+		_streams.push_back(stream);
+		
+		return (int)_streams.size() - 1;
+	}
+	
+	// In the queue of each client (the multicast group is one) : a full one loses a message, the others don't wait.
+	// Clients waiting for the same message get it together, as broadcastData() would.
+	void queueData(const std::vector<ClientInfo>& clients, int idStream, Message msg, uint64_t exposed = 0) {
+		std::shared_ptr<const Message> pMsg = std::make_shared<const Message>(std::move(msg)); // Shared by every queue, never copied
+		
+		std::lock_guard<std::mutex> lockClients(_mutClients);
+		_queue(_withMulticast(clients), idStream, pMsg, exposed);
+	}
+	
+	// The stream to its subscribers, queued as queueData() : the message is serialized once, whatever their number.
+	void broadcastData(int idStream, Message msg, uint64_t exposed = 0) {
+		std::shared_ptr<const Message> pMsg = std::make_shared<const Message>(std::move(msg));
+		
+		std::lock_guard<std::mutex> lockClients(_mutClients);
+		_queue(_withMulticast(_subscribers(idStream)), idStream, pMsg, exposed);
+	}
+	
+	// The client gets the stream sent with broadcastData(idStream, ...) : until it unsubscribes, or leaves.
+	void subscribe(const ClientInfo& client, int idStream, bool subscribed = true) {
+		if(idStream < 0 || idStream >= (int)_MAX_STREAMS)
+			return;
+		
+		ClientInfo member;
+		{
+			std::lock_guard<std::mutex> lockClients(_mutClients);
+			std::vector<ConnectedClient>::iterator itClient = _findClientFromId(client.id);
+			if(itClient == _clients.end())
+				return;
 			
-			// Send header
-			if(sendto(_udpSock, msg.data(), 14, 0, (sockaddr*) &client.udpAddress, sizeof(client.udpAddress)) != 14) {
-				std::lock_guard<std::mutex> lockCbk(_mutCbk);
-				if(_cbkError) 
-					_cbkError(Error(wlc::getError(), "UDP send Error"));
+			const uint64_t bit = 1ULL << idStream;
+			const uint64_t streams = subscribed ? (itClient->info.streams | bit) : (itClient->info.streams & ~bit);
+			if(streams == itClient->info.streams)
 				return;
-			}
-			totalLengthSend -= 14;
 			
-			// Send content
-			unsigned int offset = 14;
-			while(totalLengthSend > 0) {
-				unsigned int sizeToSend = totalLengthSend > 64000 ? 64000 : totalLengthSend;
-				
-				if(sendto(_udpSock, msg.data()+offset, sizeToSend, 0, (sockaddr*) &client.udpAddress, sizeof(client.udpAddress)) != sizeToSend) {
-					std::lock_guard<std::mutex> lockCbk(_mutCbk);
-					if(_cbkError) 
-						_cbkError(Error(wlc::getError(), "UDP send Error"));
-					return;
-				}
-				totalLengthSend -= sizeToSend;
-				offset += sizeToSend;
-			}
+			itClient->info.streams = streams;
+			if(!itClient->info.multicast)
+				return;
+			
+			itClient->info.multicast = false;
+			member = itClient->info;
 		}
+		
+		// Not the streams of the group anymore : back to unicast
+		sendInfo(member, Message(Message::HANDSHAKE, "mcast-"));
+	}
+	void unsubscribe(const ClientInfo& client, int idStream) {
+		subscribe(client, idStream, false);
 	}
 	
-	// Send message with TCP
-	void sendInfo(const ClientInfo& client, const Message& msg) const {
-		if(send(client.id, msg.data(), (int)msg.length(), 0) != (int)msg.length()) {
-			std::lock_guard<std::mutex> lockCbk(_mutCbk);
-			if(_cbkError) 
-				_cbkError(Error(wlc::getError(), "TCP send Error"));
+	// Fragments given to the kernel in 64KB buffers it segments itself (UDP GSO, Linux 4.18). Return if enabled.
+	bool setSegmentOffload(bool enable) {
+#ifdef __linux__
+		int segmentSize = (int)Fragment::DATAGRAM_SIZE;
+		if(enable && setsockopt(_udpSock, SOL_UDP, UDP_SEGMENT, &segmentSize, sizeof(segmentSize)) == 0) {
+			segmentSize = 0; // Only the messages asking for it
+			setsockopt(_udpSock, SOL_UDP, UDP_SEGMENT, &segmentSize, sizeof(segmentSize));
+			_segmentOffload = true;
+		}
+		else {
+			_segmentOffload = false;
+		}
+#endif
+		return _segmentOffload;
+	}
+	
+	// Big referenced payloads (Message with an owner) sent without the kernel copying them (MSG_ZEROCOPY, UDP since Linux 5.0).
+	// Used with the segmentation offload only, smaller messages are still copied. Return if enabled.
+	bool setZeroCopy(bool enable) {
+#ifdef __linux__
+		int value = enable ? 1 : 0;
+		_zeroCopy = setsockopt(_udpSock, SOL_SOCKET, SO_ZEROCOPY, &value, sizeof(value)) == 0 && enable;
+#endif
+		return _zeroCopy;
+	}
+	
+	// Group (ex: "239.255.0.1") and port the invited clients join : broadcastData() sends there once for all of them.
+	// The group gets a message only when all its members are in the list, else they get it by unicast. Only the clients with
+	// the streams of the members join, and a member changing its streams leaves the group ("mcast-").
+	// 'ttl' : routers crossed (1 : local network). Return if enabled.
+	bool setMulticast(const std::string& group, int port, int ttl = 1) {
+		sockaddr_in address = {};
+		address.sin_family 	= AF_INET;
+		address.sin_port 	= htons(port);
+		
+		_multicast = wlc::inetPton(group.c_str(), &address.sin_addr) == 1 && IN_MULTICAST(ntohl(address.sin_addr.s_addr))
+			&& setsockopt(_udpSock, IPPROTO_IP, IP_MULTICAST_TTL, (const char*)&ttl, sizeof(ttl)) == 0;
+		
+		if(_multicast) {
+			_group.connected 	= true;
+			_group.udpAddress 	= address;
+			_groupName 			= group + ":" + std::to_string(port);
+		}
+		return _multicast;
+	}
+	
+	// Tell the client where the group is (TCP). It joins it and confirms : until then, and if it can't, it gets unicast.
+	// Only a client subscribed to the streams of the members : changing its subscriptions, a member leaves the group ("mcast-").
+	void inviteMulticast(const ClientInfo& client) const {
+		if(!_multicast)
+			return;
+		
+		{
+			std::lock_guard<std::mutex> lockClients(_mutClients);
+			std::vector<ConnectedClient>::const_iterator itClient = _findClientFromId(client.id);
+			if(itClient == _clients.end() || itClient->info.multicast || !_canJoin(itClient->info))
+				return;
 		}
+		sendInfo(client, Message(Message::HANDSHAKE, "mcast:" + _groupName));
+	}
+	
+	// Linux : io_uring instead of epoll (multishot receives in kernel buffers, linked sends), if the kernel has it (6.0).
+	// Else, or disabled by the system, epoll is used. Before connectAt().
+	void preferUring(bool prefer) {
+		_uringWanted = prefer;
+	}
+	
+	// Send message with TCP. Not sent whole (full socket buffer), the stream would be cut in the middle of a message :
+	// the client is disconnected instead, its loop removes it.
+	void sendInfo(const ClientInfo& client, const Message& msg) const {
+		if(wlc::sendBuffers(client.id, msg.header(), Message::HEADER_SIZE, msg.content(), msg.size()) == (int)msg.length())
+			return;
+		
+		const int error = wlc::getError();
+		wlc::shutdownSocket(client.id);
+		
+		const auto cbkError = _callback(_cbkError);
+		if(cbkError) 
+			cbkError(Error(error, "TCP send Error, client disconnected"));
 	}
 	
 	// Getters
 	bool isConnected() const {
 		return _isConnected;
 	}
+	bool isSegmentOffload() const {
+		return _segmentOffload;
+	}
+	bool isZeroCopy() const {
+		return _zeroCopy;
+	}
+	bool isUring() const {
+		return _uring;
+	}
+	bool isMulticast() const {
+		return _multicast;
+	}
+	// Queue of the client (of the group, if it joined it)
+	const QueueStats getQueueStats(const ClientInfo& client, int idStream) const {
+		std::lock_guard<std::mutex> lockQueues(_mutQueues);
+		
+		auto itQueues = _queues.find(client.multicast && _multicast ? _group.id : client.id);
+		if(itQueues == _queues.end() || idStream < 0 || (size_t)idStream >= itQueues->second.streams.size())
+			return QueueStats();
+		
+		QueueStats stats = itQueues->second.streams[(size_t)idStream].stats;
+		stats.queued = itQueues->second.streams[(size_t)idStream].items.size();
+		return stats;
+	}
+	// Every client, the gone ones too
+	const QueueStats getQueueStats(int idStream) const {
+		std::lock_guard<std::mutex> lockQueues(_mutQueues);
+		if(idStream < 0 || idStream >= (int)_streams.size())
+			return QueueStats();
+		
+		QueueStats stats = _streams[(size_t)idStream].stats;
+		for(const auto& queues : _queues)
+			if((size_t)idStream < queues.second.streams.size())
+				stats.queued += queues.second.streams[(size_t)idStream].items.size();
+		return stats;
+	}
+	const ZeroCopyStats getZeroCopyStats() const {
+		ZeroCopyStats stats;
+#ifdef __linux__
+		std::lock_guard<std::mutex> lockZeroCopy(_mutZeroCopy);
+		stats = _zeroCopyStats;
+		stats.pending = _zeroCopyPending.size();
+#endif
+		return stats;
+	}
+	// Time from the capture to the end of sendto, for the messages sent with their capture time
+	const Histogram::Summary getSendLatency() const {
+		return _sendLatency.summary();
+	}
 	std::vector<ClientInfo> getClients() const {
 		std::vector<ClientInfo> clients;
 	
@@ -199,6 +425,31 @@ public:
 		
 		return clients;
 	}
+	// Connected clients subscribed to the stream
+	std::vector<ClientInfo> getSubscribers(int idStream) const {
+		std::lock_guard<std::mutex> lockClients(_mutClients);
+		return _subscribers(idStream);
+	}
+	bool isSubscribed(const ClientInfo& client, int idStream) const {
+		if(idStream < 0 || idStream >= (int)_MAX_STREAMS)
+			return false;
+		
+		std::lock_guard<std::mutex> lockClients(_mutClients);
+		for(const ConnectedClient& cc : _clients)
+			if(cc.info.id == client.id)
+				return (cc.info.streams & (1ULL << idStream)) != 0;
+		return false;
+	}
+	bool hasSubscribers(int idStream) const {
+		if(idStream < 0 || idStream >= (int)_MAX_STREAMS)
+			return false;
+		
+		std::lock_guard<std::mutex> lockClients(_mutClients);
+		for(const ConnectedClient& cc : _clients)
+			if(cc.info.connected && (cc.info.streams & (1ULL << idStream)))
+				return true;
+		return false;
+	}
 	
 	// Setters
 	void onClientConnect(const std::function<void(const ClientInfo& client)>& cbkConnect) {
@@ -209,11 +460,11 @@ public:
 		std::lock_guard<std::mutex> lockCbk(_mutCbk);
 		_cbkDisconnect = cbkDisconnect;
 	}
-	void onInfo(const std::function<void(const ClientInfo& client, const Message& message)>& cbkInfo) {
+	void onInfo(const std::function<void(const ClientInfo& client, const MessageView& message)>& cbkInfo) {
 		std::lock_guard<std::mutex> lockCbk(_mutCbk);
 		_cbkInfo = cbkInfo;	
 	}
-	void onData(const std::function<void(const ClientInfo& client, const Message& message)>& ckbData) {
+	void onData(const std::function<void(const ClientInfo& client, const MessageView& message)>& ckbData) {
 		std::lock_guard<std::mutex> lockCbk(_mutCbk);
 		_cbkData = ckbData;		
 	}
@@ -225,6 +476,600 @@ public:
 	
 private:	
 	// Methods in threads
+#ifdef __linux__
+	// Every socket in one epoll, edge triggered : accept, requests, datagrams and timers as soon as they are ready
+	void _loop() {
+		struct epoll_event events[_MAX_EVENTS];
+		while(_isConnected) {
+			const int nEvents = epoll_wait(_epfd, events, _MAX_EVENTS, -1);
+			if(nEvents == -1) {
+				if(errno == EINTR)
+					continue;
+				
+				std::lock_guard<std::mutex> lockCbk(_mutCbk);
+				if(_cbkError) 
+					_cbkError(Error(wlc::getError(), "Server loop Error"));
+				break;
+			}
+			
+			for(int i = 0; i < nEvents && _isConnected; i++) {
+				const int fd = events[i].data.fd;
+				
+				if(fd == _stopFd)
+					break;
+				else if(fd == (int)_tcpSock)
+					_acceptClients();
+				else if(fd == (int)_udpSock)
+					_readUdp(events[i].events);
+				else if(fd == _timerFd)
+					_onTimer();
+				else
+					_readTcp((SOCKET)fd);
+			}
+		}
+	}
+	
+	void _acceptClients() {
+		ClientInfo clientInfo;
+		
+		for(;;) {
+			socklen_t slen = sizeof(clientInfo.tcpAddress);
+			clientInfo.id = accept4(_tcpSock, (sockaddr*)&clientInfo.tcpAddress, &slen, SOCK_NONBLOCK | SOCK_CLOEXEC);
+			
+			if((int)clientInfo.id == SOCKET_ERROR) {
+				const int error = wlc::getError();
+				if(error == EINTR || error == ECONNABORTED)
+					continue;
+				
+				if(!wlc::errorIs(wlc::WOULD_BLOCK, error)) {
+					std::lock_guard<std::mutex> lockCbk(_mutCbk);
+					if(_cbkError) 
+						_cbkError(Error(error, "TCP accept Error"));
+				}
+				return;
+			}
+			
+			if(!_watch(clientInfo.id, EPOLLIN | EPOLLRDHUP | EPOLLET)) {
+				wlc::closeSocket(clientInfo.id);
+				continue;
+			}
+			
+			_addClient(clientInfo);
+		}
+	}
+	
+	void _addClient(ClientInfo& clientInfo) {
+		// Update infos
+		clientInfo.lastUpdate = clock();
+		memset(&clientInfo.udpAddress, 0, sizeof(clientInfo.udpAddress)); 
+		
+		_mutClients.lock();
+		_clients.push_back(ConnectedClient(clientInfo)); // Add to list
+		_mutClients.unlock();
+		
+		sendInfo(clientInfo, Message(Message::HANDSHAKE, "udp?")); // Ask for its udp address
+	}
+	
+	// Until the socket is empty : edge triggered
+	void _readTcp(SOCKET idClient) {
+		char buf[_TCP_BUFFER_SIZE];
+		
+		for(;;) {
+			const ssize_t recv_len = recv(idClient, buf, sizeof(buf), 0);
+			if(recv_len > 0) {
+				_onTcpData(idClient, buf, (size_t)recv_len);
+				continue;
+			}
+			
+			if(recv_len == SOCKET_ERROR) {
+				const int error = wlc::getError();
+				if(error == EINTR)
+					continue;
+				if(wlc::errorIs(wlc::WOULD_BLOCK, error))
+					return;
+				
+				if(!wlc::errorIs(wlc::REFUSED_CONNECT, error) && error != ECONNRESET) {
+					std::lock_guard<std::mutex> lockCbk(_mutCbk);
+					if(_cbkError) 
+						_cbkError(Error(error, "TCP receive Error"));
+				}
+			}
+			
+			// Stopped connection
+			return _removeClient(idClient);
+		}
+	}
+	
+	// Messages may be cut between two reads : the end is kept for the next one
+	void _onTcpData(SOCKET idClient, const char* buf, size_t len) {
+		std::vector<ConnectedClient>::iterator itClient = _findClientFromId(idClient);
+		if(itClient == _clients.end())
+			return;
+		
+		_mutClients.lock();
+		itClient->info.lastUpdate = clock();
+		_mutClients.unlock();
+		
+		// Only this thread changes the clients : no lock needed to read them
+		const ClientInfo client = itClient->info;
+		auto onMessage = [&](const MessageView& message) {
+			if(_onMulticastJoined(itClient->info, message))
+				return;
+			
+			const auto cbkInfo = _callback(_cbkInfo);
+			if(cbkInfo)
+				cbkInfo(client, message);
+		};
+		
+		std::vector<char>& received(itClient->received);
+		if(received.empty()) {
+			const size_t read = MessageManager::readMessages(buf, len, onMessage);
+			received.assign(buf + read, buf + len);
+		}
+		else {
+			received.insert(received.end(), buf, buf + len);
+			const size_t read = MessageManager::readMessages(received.data(), received.size(), onMessage);
+			received.erase(received.begin(), received.begin() + read);
+		}
+		
+		// Not a message
+		if(received.size() > _TCP_MAX_PENDING)
+			received.clear();
+	}
+	
+	void _removeClient(SOCKET idClient) {
+		ClientInfo client;
+		{
+			std::lock_guard<std::mutex> lockClients(_mutClients);
+			std::vector<ConnectedClient>::iterator itClient = _findClientFromId(idClient);
+			if(itClient == _clients.end())
+				return;
+			
+			if(_epfd != -1)
+				epoll_ctl(_epfd, EPOLL_CTL_DEL, (int)idClient, nullptr);
+			itClient->disconnect();
+			client = itClient->info;
+			_clients.erase(itClient);
+		}
+		_dropQueues(idClient);
+		
+		const auto cbkDisconnect = _callback(_cbkDisconnect);
+		if(cbkDisconnect)
+			cbkDisconnect(client);
+	}
+	
+	void _readUdp(uint32_t events) {
+		// Zero copy notifications wake us up as errors
+		if((events & EPOLLERR) && _zeroCopy) {
+			std::lock_guard<std::mutex> lockZeroCopy(_mutZeroCopy);
+			_reapZeroCopy();
+		}
+		
+		char buf[_UDP_BUFFER_SIZE];
+		sockaddr_in clientAddress;
+		
+		for(;;) {
+			socklen_t slen = sizeof(clientAddress);
+			const ssize_t recv_len = recvfrom(_udpSock, buf, sizeof(buf), 0, (sockaddr *) &clientAddress, &slen);
+			
+			if(recv_len == SOCKET_ERROR) {
+				const int error = wlc::getError();
+				if(error == EINTR)
+					continue;
+				if(wlc::errorIs(wlc::WOULD_BLOCK, error))
+					return;
+				
+				// Errors on the socket are reported once, the next datagrams are still there
+				if(!wlc::errorIs(wlc::REFUSED_CONNECT, error)) {
+					std::lock_guard<std::mutex> lockCbk(_mutCbk);
+					if(_cbkError) 
+						_cbkError(Error(error, "UDP receive Error"));
+				}
+				continue;
+			}
+			
+			_onDatagram(buf, (size_t)recv_len, clientAddress, clock());
+		}
+	}
+	
+	// Clients without udp yet : the handshake datagram may have been lost
+	void _onTimer() {
+		uint64_t expirations = 0;
+		if(read(_timerFd, &expirations, sizeof(expirations)) != sizeof(expirations))
+			return;
+		
+		_askUdp();
+	}
+	void _askUdp() {
+		for(const ConnectedClient& client : _clients) 
+			if(!client.info.connected)
+				sendInfo(client.info, Message(Message::HANDSHAKE, "udp?"));
+	}
+	
+	bool _watch(SOCKET fd, uint32_t events) {
+		struct epoll_event event = {};
+		event.events 	= events;
+		event.data.fd 	= (int)fd;
+		return epoll_ctl(_epfd, EPOLL_CTL_ADD, (int)fd, &event) == 0;
+	}
+	bool _startLoop() {
+		_epfd 	= epoll_create1(EPOLL_CLOEXEC);
+		_timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+		if(_epfd == -1 || _timerFd == -1)
+			return false;
+		
+		struct itimerspec period = {};
+		period.it_interval.tv_nsec 	= _HANDSHAKE_RETRY_MS * 1000000L;
+		period.it_value 			= period.it_interval;
+		if(timerfd_settime(_timerFd, 0, &period, nullptr) == -1)
+			return false;
+		
+		if(!_watch(_stopFd, EPOLLIN) || !_watch(_timerFd, EPOLLIN | EPOLLET))
+			return false;
+		if(!_watch(_tcpSock, EPOLLIN | EPOLLET) || !_watch(_udpSock, EPOLLIN | EPOLLET))
+			return false;
+		
+		_pLoop = std::make_shared<std::thread>(&Server::_loop, this);
+		return true;
+	}
+	void _stopLoop() {
+		if(_stopFd != -1) {
+			uint64_t one = 1;
+			if(write(_stopFd, &one, sizeof(one)) != sizeof(one))
+				perror(" [Server] Stopping");
+		}
+		
+		if(_pLoop && _pLoop->joinable())
+			_pLoop->join();
+		_pLoop.reset();
+		
+		for(int* pFd : {&_epfd, &_stopFd, &_timerFd}) {
+			if(*pFd != -1)
+				close(*pFd);
+			*pFd = -1;
+		}
+		
+#ifdef URING_AVAILABLE
+		_stopUring();
+#endif
+	}
+	
+#ifdef URING_AVAILABLE
+	// ------------ io_uring loop : the same events as completions ------------
+	// Accept and receives are multishot : armed once, they complete for each client and each read.
+	// The kernel picks the receive buffers in two rings (tcp, udp) : given back once read, no copy.
+	void _loopUring() {
+		bool stop = false;
+		while(_isConnected && !stop) {
+			if(_ring.submit(1) == -1 && errno != EINTR && errno != EBUSY && errno != EAGAIN) {
+				std::lock_guard<std::mutex> lockCbk(_mutCbk);
+				if(_cbkError) 
+					_cbkError(Error(wlc::getError(), "Server loop Error"));
+				break;
+			}
+			
+			_ring.reap([&](const struct io_uring_cqe& cqe) {
+				if(!stop)
+					stop = !_onCompletion(cqe);
+			});
+		}
+	}
+	
+	// False to stop the loop
+	bool _onCompletion(const struct io_uring_cqe& cqe) {
+		const uint64_t op = cqe.user_data >> 32;
+		const SOCKET fd = (SOCKET)(cqe.user_data & 0xFFFFFFFF);
+		const bool more = (cqe.flags & IORING_CQE_F_MORE) != 0;
+		
+		switch(op) {
+		case _OP_STOP:
+			return false;
+		
+		case _OP_ACCEPT:
+			if(cqe.res >= 0) {
+				ClientInfo clientInfo;
+				clientInfo.id = (SOCKET)cqe.res;
+				socklen_t slen = sizeof(clientInfo.tcpAddress);
+				getpeername(clientInfo.id, (sockaddr*)&clientInfo.tcpAddress, &slen);
+				
+				_armRecv(clientInfo.id);
+				_addClient(clientInfo);
+			}
+			else if(cqe.res != -EINTR && cqe.res != -ECONNABORTED) {
+				std::lock_guard<std::mutex> lockCbk(_mutCbk);
+				if(_cbkError) 
+					_cbkError(Error(-cqe.res, "TCP accept Error"));
+			}
+			
+			// Stopped on error (ex: no more files) : armed again with the timer, not in a loop
+			if(!more)
+				_acceptArmed = cqe.res >= 0 ? _armAccept() : false;
+			break;
+		
+		case _OP_TCP:
+			_onUringTcp(fd, cqe, more);
+			break;
+			
+		case _OP_UDP:
+			_onUringUdp(cqe, more);
+			break;
+			
+		case _OP_TIMER:
+			_askUdp();
+			if(!_acceptArmed)
+				_acceptArmed = _armAccept();
+			_armTimer();
+			break;
+			
+		case _OP_ERRORS: 
+		{
+			// Zero copy notifications, or an error waiting on the socket
+			std::lock_guard<std::mutex> lockZeroCopy(_mutZeroCopy);
+			_reapZeroCopy();
+			
+			int error = 0;
+			socklen_t len = sizeof(error);
+			getsockopt(_udpSock, SOL_SOCKET, SO_ERROR, &error, &len);
+			_armPoll(_udpSock, POLLERR, _OP_ERRORS);
+			break;
+		}
+		}
+		
+		return true;
+	}
+	
+	void _onUringTcp(SOCKET idClient, const struct io_uring_cqe& cqe, bool more) {
+		if(cqe.res > 0) {
+			const uint16_t idBuffer = Uring::BufferRing::idOf(cqe);
+			_onTcpData(idClient, _tcpBuffers.buffer(idBuffer), (size_t)cqe.res);
+			_tcpBuffers.give(idBuffer);
+			
+			if(!more)
+				_armRecv(idClient);
+			return;
+		}
+		
+		// Every buffer in use : the data waits in the socket
+		if(cqe.res == -ENOBUFS)
+			return (void)_armRecv(idClient);
+		
+		if(cqe.res < 0 && cqe.res != -ECONNRESET && cqe.res != -ECONNREFUSED) {
+			std::lock_guard<std::mutex> lockCbk(_mutCbk);
+			if(_cbkError) 
+				_cbkError(Error(-cqe.res, "TCP receive Error"));
+		}
+		
+		// Stopped connection
+		_removeClient(idClient);
+	}
+	
+	void _onUringUdp(const struct io_uring_cqe& cqe, bool more) {
+		if(cqe.res >= 0 && Uring::BufferRing::hasBuffer(cqe)) {
+			// In the buffer : lengths, source address, then the datagram
+			const uint16_t idBuffer = Uring::BufferRing::idOf(cqe);
+			const char* buf = _udpBuffers.buffer(idBuffer);
+			
+			struct io_uring_recvmsg_out out;
+			memcpy(&out, buf, sizeof(out));
+			
+			if(!(out.flags & MSG_TRUNC) && out.namelen >= sizeof(sockaddr_in)) {
+				sockaddr_in clientAddress;
+				memcpy(&clientAddress, buf + sizeof(out), sizeof(clientAddress));
+				_onDatagram(buf + sizeof(out) + _udpHeader.msg_namelen, out.payloadlen, clientAddress, clock());
+			}
+			_udpBuffers.give(idBuffer);
+		}
+		else if(cqe.res < 0 && cqe.res != -ENOBUFS && cqe.res != -ECONNREFUSED) {
+			std::lock_guard<std::mutex> lockCbk(_mutCbk);
+			if(_cbkError) 
+				_cbkError(Error(-cqe.res, "UDP receive Error"));
+		}
+		
+		if(!more)
+			_armRecvUdp();
+	}
+	
+	// Operations : tag in the high bits, socket in the low bits
+	struct io_uring_sqe* _nextSqe() {
+		struct io_uring_sqe* sqe = _ring.getSqe();
+		if(!sqe && _ring.submit() >= 0) // Full : give them to the kernel now
+			sqe = _ring.getSqe();
+		return sqe;
+	}
+	static uint64_t _tag(uint64_t op, SOCKET fd) {
+		return (op << 32) | (uint32_t)fd;
+	}
+	bool _armAccept() {
+		struct io_uring_sqe* sqe = _nextSqe();
+		if(!sqe)
+			return false;
+		
+		Uring::prepare(sqe, IORING_OP_ACCEPT, (int)_tcpSock, nullptr, 0, _tag(_OP_ACCEPT, _tcpSock));
+		sqe->accept_flags 	= SOCK_NONBLOCK | SOCK_CLOEXEC;
+		sqe->ioprio 		= IORING_ACCEPT_MULTISHOT;
+		return true;
+	}
+	bool _armRecv(SOCKET idClient) {
+		struct io_uring_sqe* sqe = _nextSqe();
+		if(!sqe)
+			return false;
+		
+		Uring::prepare(sqe, IORING_OP_RECV, (int)idClient, nullptr, 0, _tag(_OP_TCP, idClient));
+		sqe->flags 		= IOSQE_BUFFER_SELECT;
+		sqe->buf_group 	= _tcpBuffers.group();
+		sqe->ioprio 	= IORING_RECV_MULTISHOT;
+		return true;
+	}
+	bool _armRecvUdp() {
+		struct io_uring_sqe* sqe = _nextSqe();
+		if(!sqe)
+			return false;
+		
+		Uring::prepare(sqe, IORING_OP_RECVMSG, (int)_udpSock, &_udpHeader, 1, _tag(_OP_UDP, _udpSock));
+		sqe->flags 		= IOSQE_BUFFER_SELECT;
+		sqe->buf_group 	= _udpBuffers.group();
+		sqe->ioprio 	= IORING_RECV_MULTISHOT;
+		return true;
+	}
+	bool _armTimer() {
+		struct io_uring_sqe* sqe = _nextSqe();
+		if(!sqe)
+			return false;
+		
+		Uring::prepare(sqe, IORING_OP_TIMEOUT, -1, &_retryPeriod, 1, _tag(_OP_TIMER, 0));
+		return true;
+	}
+	bool _armPoll(SOCKET fd, uint32_t events, uint64_t op) {
+		struct io_uring_sqe* sqe = _nextSqe();
+		if(!sqe)
+			return false;
+		
+		Uring::prepare(sqe, IORING_OP_POLL_ADD, (int)fd, nullptr, 0, _tag(op, fd));
+		sqe->poll32_events = events;
+		return true;
+	}
+	
+	bool _startUring() {
+		if(!_uringWanted)
+			return false;
+		
+		if(!_ring.init(_URING_ENTRIES) || !_sendRing.init(_URING_ENTRIES) 
+			|| !_tcpBuffers.init(_ring, _BUFFERS_TCP, _URING_TCP_BUFFERS, (uint32_t)_TCP_BUFFER_SIZE)
+			|| !_udpBuffers.init(_ring, _BUFFERS_UDP, _URING_UDP_BUFFERS, (uint32_t)(sizeof(struct io_uring_recvmsg_out) + sizeof(sockaddr_in) + _UDP_BUFFER_SIZE))) 
+		{
+			_stopUring();
+			return false;
+		}
+		
+		memset(&_udpHeader, 0, sizeof(_udpHeader));
+		_udpHeader.msg_namelen = sizeof(sockaddr_in);
+		
+		_retryPeriod.tv_sec 	= 0;
+		_retryPeriod.tv_nsec 	= _HANDSHAKE_RETRY_MS * 1000000LL;
+		
+		_acceptArmed = _armAccept();
+		_armRecvUdp();
+		_armTimer();
+		_armPoll((SOCKET)_stopFd, POLLIN, _OP_STOP);
+		_armPoll(_udpSock, POLLERR, _OP_ERRORS);
+		
+		// Multishot refused right away (kernel older than 6.0) : epoll instead
+		bool refused = _ring.submit() == -1;
+		_ring.reap([&](const struct io_uring_cqe& cqe) {
+			if(cqe.res == -EINVAL)
+				refused = true;
+			else if(!refused)
+				_onCompletion(cqe);
+		});
+		
+		if(refused) {
+			_stopUring();
+			return false;
+		}
+		
+		_uring = true;
+		_pLoop = std::make_shared<std::thread>(&Server::_loopUring, this);
+		return true;
+	}
+	void _stopUring() {
+		_tcpBuffers.release();
+		_udpBuffers.release();
+		_ring.release();
+		
+		std::lock_guard<std::mutex> lockSend(_mutSendRing);
+		_sendRing.release();
+		_uring = false;
+	}
+	
+	// Every datagram in the send ring, those of a client linked so they leave in order : one syscall for the burst.
+	// An error cancels the rest of its chain (lost, like after a full buffer), the other clients are still served.
+	bool _sendLinked(std::vector<struct mmsghdr>& datagrams, size_t& sent) const {
+		std::lock_guard<std::mutex> lockSend(_mutSendRing);
+		if(!_sendRing.isValid())
+			return false;
+		
+		size_t dropped = 0;
+		int lastError = 0;
+		
+		while(sent < datagrams.size()) {
+			const unsigned int count = (unsigned int)std::min(datagrams.size() - sent, (size_t)_sendRing.entries());
+			for(unsigned int i = 0; i < count; i++) {
+				const struct msghdr& header(datagrams[sent + i].msg_hdr);
+				
+				struct io_uring_sqe* sqe = _sendRing.getSqe();
+				Uring::prepare(sqe, IORING_OP_SENDMSG, (int)_udpSock, &header, 1, sent + i);
+				if(i + 1 < count && datagrams[sent + i + 1].msg_hdr.msg_name == header.msg_name)
+					sqe->flags = IOSQE_IO_LINK;
+			}
+			
+			// Wait for all of them, at most _SEND_TIMEOUT_MS, then cancel the rest
+			unsigned int expected = count;
+			unsigned int done = 0;
+			bool cancelled = false;
+			bool broken = false;
+			int failures = 0;
+			uint64_t deadline = Timer::monotonicMus() + _SEND_TIMEOUT_MS * 1000ULL;
+			
+			while(done < expected) {
+				const uint64_t now = Timer::monotonicMus();
+				if(!cancelled && now >= deadline) {
+					struct io_uring_sqe* sqe = _sendRing.getSqe();
+					if(sqe) {
+						Uring::prepare(sqe, IORING_OP_ASYNC_CANCEL, -1, nullptr, 0, _SEND_CANCEL);
+						sqe->cancel_flags = IORING_ASYNC_CANCEL_ANY;
+						expected++;
+					}
+					cancelled = true;
+				}
+				
+				const int timeoutMs = cancelled ? -1 : (int)((deadline - now + 999) / 1000);
+				if(_sendRing.submit(expected - done, timeoutMs) == -1 && errno != EINTR && errno != ETIME && errno != EAGAIN && errno != EBUSY) {
+					lastError = errno;
+					
+					// Still in flight, they point at 'datagrams' : cancelled, and waited for before returning
+					if(!cancelled) {
+						deadline = now;
+					}
+					else if(++failures >= _URING_SEND_RETRIES) { // Can't wait anymore : closing the ring cancels them in the kernel
+						_sendRing.release();
+						broken = true;
+						break;
+					}
+					else {
+						std::this_thread::sleep_for(std::chrono::milliseconds(1));
+					}
+				}
+				
+				done += _sendRing.reap([&](const struct io_uring_cqe& cqe) {
+					if(cqe.user_data == _SEND_CANCEL || cqe.res >= 0)
+						return;
+					
+					dropped++;
+					if(cqe.res != -ECANCELED)
+						lastError = -cqe.res;
+				});
+			}
+			
+			sent += count;
+			if(broken) // The next ones with sendmmsg
+				break;
+		}
+		
+		if(dropped == 0 && lastError == 0)
+			return true;
+		
+		std::lock_guard<std::mutex> lockCbk(_mutCbk);
+		if(_cbkError) 
+			_cbkError(Error(lastError, "UDP send Error: " + std::to_string(dropped) + " datagrams dropped"));
+		return false;
+	}
+#else
+	bool _startUring() {
+		return false; // Kernel headers without multishot receives
+	}
+#endif
+	
+#else
 	void _handleTcp() {
 		// Listen
 		if(!_isConnected || listen(_tcpSock, SOMAXCONN) == SOCKET_ERROR)
@@ -304,17 +1149,20 @@ private:
 			if(recv_len < 14) // Bad message
 				continue;
 			
-			for(const Message& message : MessageManager::readMessages(buf, recv_len)) {
-				std::lock_guard<std::mutex> lockCbk(_mutCbk);
-				if(_cbkInfo) 
-					_cbkInfo(client, message);
-			}
+			MessageManager::readMessages(buf, (size_t)recv_len, [&](const MessageView& message) {
+				if(_onMulticastJoined(client, message))
+					return;
+				
+				const auto cbkInfo = _callback(_cbkInfo);
+				if(cbkInfo)
+					cbkInfo(client, message);
+			});
 		}
 		
 		// End
-		std::lock_guard<std::mutex> lockCbk(_mutCbk);
-		if(_cbkDisconnect) 
-			_cbkDisconnect(client);	
+		const auto cbkDisconnect = _callback(_cbkDisconnect);
+		if(cbkDisconnect)
+			cbkDisconnect(client);
 		
 		std::lock_guard<std::mutex> lockClients(_mutClients);
 		std::vector<ConnectedClient>::iterator itClient = _findClientFromAddress(client.tcpAddress);
@@ -323,6 +1171,7 @@ private:
 			itClient->disconnect();
 			_garbageItClients.push_back(itClient);
 		}
+		_dropQueues(client.id);
 	}
 	
 	void _recvUdp() {
@@ -359,44 +1208,567 @@ private:
 			if(recv_len == 0) 
 				continue;
 			
-			// Read message
-			if(recv_len < 14) // Bad message
+			_onDatagram(buf, (size_t)recv_len, clientAddress, time);
+		}
+	}
+#endif
+	
+	// ------------ Send thread : the queues, a message by client at each turn ------------
+	void _sendQueued() {
+		std::unique_lock<std::mutex> lockQueues(_mutQueues);
+		
+		for(;;) {
+			_cvQueues.wait(lockQueues, [this]() { 
+				return !_sending || _hasQueued(); 
+			});
+			if(!_sending)
+				break;
+			
+			// Streams in turn, so a backlog of one doesn't hold the others. Same message : sent together.
+			std::vector<_Batch> batches;
+			for(auto& entry : _queues) {
+				_ClientQueues& queues(entry.second);
+				
+				for(size_t i = 0; i < queues.streams.size(); i++) {
+					const size_t idStream = (queues.next + i) % queues.streams.size();
+					_Queue& queue(queues.streams[idStream]);
+					if(queue.items.empty())
+						continue;
+					
+					const _Queued item = queue.items.front();
+					queue.items.pop_front();
+					queue.stats.sent++;
+					_streams[idStream].stats.sent++;
+					queues.next = idStream + 1;
+					
+					auto itBatch = std::find_if(batches.begin(), batches.end(), [&](const _Batch& batch) {
+						return batch.item.pMsg == item.pMsg;
+					});
+					if(itBatch == batches.end())
+						itBatch = batches.insert(batches.end(), _Batch{item, std::vector<ClientInfo>()});
+					itBatch->clients.push_back(queues.target);
+					break;
+				}
+			}
+			
+			// Sent without the queues locked : the producers don't wait
+			lockQueues.unlock();
+			for(const _Batch& batch : batches)
+				if(_sendNow(batch.clients, *batch.item.pMsg))
+					_recordLatency(batch.item.exposed);
+			lockQueues.lock();
+		}
+	}
+	bool _hasQueued() const {
+		for(const auto& queues : _queues)
+			for(const _Queue& queue : queues.second.streams)
+				if(!queue.items.empty())
+					return true;
+		return false;
+	}
+	void _stopSending() {
+		{
+			std::lock_guard<std::mutex> lockQueues(_mutQueues);
+			_sending = false;
+		}
+		_cvQueues.notify_all();
+		
+		if(_pSend && _pSend->joinable())
+			_pSend->join();
+		_pSend.reset();
+		
+		std::lock_guard<std::mutex> lockQueues(_mutQueues);
+		_queues.clear();
+	}
+	void _dropQueues(SOCKET idClient) {
+		std::lock_guard<std::mutex> lockQueues(_mutQueues);
+		_queues.erase(idClient);
+	}
+	
+	bool _sendNow(const std::vector<ClientInfo>& targets, const Message& msg) const {
+		if(targets.empty())
+			return false;
+		
+#ifdef __linux__
+		return _broadcastUdp(targets, msg);
+#else
+		bool success = true;
+		for(const ClientInfo& client : targets)
+			success = _sendUdp(client, msg) && success;
+		return success;
+#endif
+	}
+	
+	// Joined the group : no more unicast copies. Its subscriptions changed since the invitation : told to leave.
+	bool _onMulticastJoined(ClientInfo& client, const MessageView& message) {
+		if(message.code() != Message::HANDSHAKE || !message.is("mcast."))
+			return false;
+		
+		bool joined = false;
+		{
+			std::lock_guard<std::mutex> lockClients(_mutClients);
+			joined = _multicast && _canJoin(client);
+			client.multicast = joined;
+		}
+		
+		if(!joined)
+			sendInfo(client, Message(Message::HANDSHAKE, "mcast-"));
+		return true;
+	}
+	
+	// Same streams as the other members. Under _mutClients.
+	bool _canJoin(const ClientInfo& client) const {
+		for(const ConnectedClient& cc : _clients)
+			if(cc.info.id != client.id && cc.info.connected && cc.info.multicast && cc.info.streams != client.streams)
+				return false;
+		return true;
+	}
+	
+	// The clients still there. The members replaced by the group if they are all in the list : the group never gets
+	// what one of them didn't ask for. Under _mutClients.
+	std::vector<ClientInfo> _withMulticast(const std::vector<ClientInfo>& clients) const {
+		std::vector<ClientInfo> targets;
+		size_t members = 0;
+		for(const ClientInfo& client : clients) {
+			std::vector<ConnectedClient>::const_iterator itClient = _findClientFromId(client.id);
+			if(itClient == _clients.end() || !itClient->info.connected)
 				continue;
-			Message message(buf, recv_len);
 			
-			// Update list
+			targets.push_back(itClient->info); // Its address now, not the caller's copy
+			if(_multicast && itClient->info.multicast)
+				members++;
+		}
+		
+		const size_t allMembers = (size_t)std::count_if(_clients.begin(), _clients.end(), [](const ConnectedClient& cc) {
+			return cc.info.connected && cc.info.multicast;
+		});
+		if(members == 0 || members < allMembers)
+			return targets;
+		
+		targets.erase(std::remove_if(targets.begin(), targets.end(), [](const ClientInfo& client) {
+			return client.multicast;
+		}), targets.end());
+		targets.push_back(_group);
+		return targets;
+	}
+	
+	// Under _mutClients
+	std::vector<ClientInfo> _subscribers(int idStream) const {
+		std::vector<ClientInfo> subscribers;
+		if(idStream < 0 || idStream >= (int)_MAX_STREAMS)
+			return subscribers;
+		
+		for(const ConnectedClient& cc : _clients)
+			if(cc.info.connected && (cc.info.streams & (1ULL << idStream)))
+				subscribers.push_back(cc.info);
+		return subscribers;
+	}
+	
+	// In the queues of the targets. Under _mutClients : a removed client would get a queue back after _dropQueues()
+	void _queue(const std::vector<ClientInfo>& targets, int idStream, const std::shared_ptr<const Message>& pMsg, uint64_t exposed) {
+		if(targets.empty())
+			return;
+		
+		const _Queued item = {pMsg, exposed};
+		{
+			std::lock_guard<std::mutex> lockQueues(_mutQueues);
+			if(idStream < 0 || idStream >= (int)_streams.size())
+				return;
+			
+			_Stream& stream(_streams[(size_t)idStream]);
+			for(const ClientInfo& target : targets) {
+				_ClientQueues& queues(_queues[target.id]);
+				queues.target = target;
+				if(queues.streams.size() < _streams.size())
+					queues.streams.resize(_streams.size());
+				
+				_Queue& queue(queues.streams[(size_t)idStream]);
+				if(queue.items.size() >= stream.capacity) {
+					queue.items.pop_front();
+					queue.stats.dropped++;
+					stream.stats.dropped++;
+				}
+				queue.items.push_back(item);
+			}
+		}
+		_cvQueues.notify_one();
+	}
+	
+	// Handshake of the client, then its data
+	void _onDatagram(const char* buf, size_t len, const sockaddr_in& clientAddress, clock_t time) {
+		// Read message
+		if(len < 14) // Bad message
+			return;
+		
+		MessageView message(buf, len);
+		if(!message.isComplete())
+			return;
+		
+		// Update list
+		ClientInfo client;
+		bool wasConnected = false;
+		{
 			std::lock_guard<std::mutex> lockMut(_mutClients); // Free mutex when scope end
 			
 			std::vector<ConnectedClient>::iterator itClient = _findClientFromAddress(clientAddress);
-			if(itClient != _clients.end()) {
-				itClient->info.lastUpdate = time;
+			if(itClient == _clients.end())
+				return;
+			
+			itClient->info.lastUpdate = time;
+			wasConnected = itClient->info.connected;
+			
+			// First time ?
+			if(!wasConnected && message.code() == Message::HANDSHAKE && message.is("udp.")) {
+				itClient->info.connected = true;
+				itClient->info.udpAddress = clientAddress;
+			}
+			client = itClient->info;
+		}
+		
+		// Callbacks without the clients locked : they may ask for them
+		if(wasConnected) { // Read data message
+			const auto cbkData = _callback(_cbkData);
+			if(cbkData)
+				cbkData(client, message);
+		}
+		else if(client.connected) {
+			sendInfo(client, Message(Message::HANDSHAKE, "ok."));	
+			
+			const auto cbkConnect = _callback(_cbkConnect);
+			if(cbkConnect)
+				cbkConnect(client);
+		}
+		else { // Shakehand error
+			std::lock_guard<std::mutex> lockCbk(_mutCbk);
+			if(_cbkError) 
+				_cbkError(Error(Error::BAD_CONNECTION, "Handshake Error"));
+		}
+	}
+	
+	// Send, in fragments fitting the MTU if too big
+	bool _sendUdp(const ClientInfo& client, const Message& msg) const {
+#ifdef __linux__
+		return _broadcastUdp(std::vector<ClientInfo>(1, client), msg);
+#else
+		if(!Fragment::needed(msg)) {
+			if(wlc::sendBuffers(_udpSock, msg.header(), Message::HEADER_SIZE, msg.content(), msg.size(), &client.udpAddress) != (int)msg.length()) {
+				std::lock_guard<std::mutex> lockCbk(_mutCbk);
+				if(_cbkError) 
+					_cbkError(Error(wlc::getError(), "UDP send Error"));
+				return false;
+			}
+			return true;
+		}
+		
+		char datagram[Fragment::DATAGRAM_SIZE];
+		for(const Fragment::Piece& piece : Fragment::split(msg, _sequence++)) {
+			memcpy(datagram, piece.header, Fragment::HEADER_SIZE);
+			memcpy(datagram + Fragment::HEADER_SIZE, piece.data[0], piece.length[0]);
+			if(piece.length[1] > 0)
+				memcpy(datagram + Fragment::HEADER_SIZE + piece.length[0], piece.data[1], piece.length[1]);
+			
+			const int sizeToSend = (int)(Fragment::HEADER_SIZE + piece.length[0] + piece.length[1]);
+			if(sendto(_udpSock, datagram, sizeToSend, 0, (sockaddr*) &client.udpAddress, sizeof(client.udpAddress)) != sizeToSend) {
+				std::lock_guard<std::mutex> lockCbk(_mutCbk);
+				if(_cbkError) 
+					_cbkError(Error(wlc::getError(), "UDP send Error"));
+				return false;
+			}
+		}
+		return true;
+#endif
+	}
+	
+#ifdef __linux__
+	bool _broadcastUdp(const std::vector<ClientInfo>& clients, const Message& msg) const {
+		if(_zeroCopy && _segmentOffload && msg.owner() && msg.length() >= _ZEROCOPY_MIN)
+			return _broadcastZeroCopy(clients, msg);
+		
+		std::vector<Fragment::Piece> pieces;
+		if(Fragment::needed(msg))
+			pieces = Fragment::split(msg, _sequence++);
+		
+		return _sendDatagrams(clients, msg, pieces);
+	}
+	
+	// The kernel reads the buffers after sendmmsg returned : the message and its fragment headers are kept until it says it's done
+	bool _broadcastZeroCopy(const std::vector<ClientInfo>& clients, const Message& msg) const {
+		std::lock_guard<std::mutex> lockZeroCopy(_mutZeroCopy); // Notification ids follow the sends
+		_reapZeroCopy();
+		
+		std::shared_ptr<_ZeroCopyKept> pKept = std::make_shared<_ZeroCopyKept>(msg); // Copy of the header, payload shared
+		pKept->pieces = Fragment::split(pKept->msg, _sequence++);
+		
+		size_t accepted = 0;
+		const bool success = _sendDatagrams(clients, pKept->msg, pKept->pieces, MSG_ZEROCOPY, &accepted);
+		
+		if(accepted > 0) {
+			_ZeroCopySend send = {_zeroCopyNext, (uint32_t)accepted, (uint32_t)accepted, pKept};
+			_zeroCopyPending.push_back(send);
+			_zeroCopyNext += (uint32_t)accepted;
+			_zeroCopyStats.sends += accepted;
+		}
+		return success;
+	}
+	
+	// Notifications on the error queue : ranges of sends the kernel doesn't need anymore. Under _mutZeroCopy.
+	void _reapZeroCopy() const {
+		char control[CMSG_SPACE(sizeof(struct sock_extended_err) + sizeof(struct sockaddr_in))];
+		
+		for(;;) {
+			struct msghdr header = {};
+			header.msg_control 		= control;
+			header.msg_controllen 	= sizeof(control);
+			if(recvmsg(_udpSock, &header, MSG_ERRQUEUE | MSG_DONTWAIT) == -1)
+				break; // Empty
+			
+			for(struct cmsghdr* cmsg = CMSG_FIRSTHDR(&header); cmsg != nullptr; cmsg = CMSG_NXTHDR(&header, cmsg)) {
+				if(cmsg->cmsg_level != SOL_IP || cmsg->cmsg_type != IP_RECVERR)
+					continue;
 				
-				// First time ?
-				if(!itClient->info.connected) {
-					if(message.code() == Message::HANDSHAKE && message.str() == "udp.") {
-						itClient->info.connected = true;
-						itClient->info.udpAddress = clientAddress;
-						
-						sendInfo(itClient->info, Message(Message::HANDSHAKE, "ok."));	
-						
-						std::lock_guard<std::mutex> lockCbk(_mutCbk);
-						if(_cbkConnect) 
-							_cbkConnect(itClient->info);
-					}
-					else { // Shakehand error
-						std::lock_guard<std::mutex> lockCbk(_mutCbk);
-						if(_cbkError) 
-							_cbkError(Error(Error::BAD_CONNECTION, "Handshake Error"));
-					}
+				struct sock_extended_err error;
+				memcpy(&error, CMSG_DATA(cmsg), sizeof(error));
+				if(error.ee_errno == 0 && error.ee_origin == SO_EE_ORIGIN_ZEROCOPY)
+					_releaseZeroCopy(error.ee_info, error.ee_data, (error.ee_code & SO_EE_CODE_ZEROCOPY_COPIED) != 0);
+			}
+		}
+	}
+	void _releaseZeroCopy(uint32_t first, uint32_t last, bool copied) const {
+		const uint32_t count = last - first + 1;
+		_zeroCopyStats.completed += count;
+		if(copied)
+			_zeroCopyStats.copied += count;
+		
+		for(auto it = _zeroCopyPending.begin(); it != _zeroCopyPending.end(); ) {
+			// Ids in both ranges. Offsets instead of comparisons : the ids wrap around.
+			uint32_t overlap = 0;
+			const uint32_t sendAfter = it->first - first;
+			const uint32_t sendBefore = first - it->first;
+			if(sendAfter < count)
+				overlap = std::min(it->count, count - sendAfter);
+			else if(sendBefore < it->count)
+				overlap = std::min(it->count - sendBefore, count);
+			
+			it->remaining -= std::min(overlap, it->remaining);
+			if(it->remaining == 0)
+				it = _zeroCopyPending.erase(it);
+			else
+				++it;
+		}
+	}
+	
+	bool _sendDatagrams(const std::vector<ClientInfo>& clients, const Message& msg, const std::vector<Fragment::Piece>& pieces, int flags = 0, size_t* accepted = nullptr) const {
+		if(!pieces.empty() && _segmentOffload)
+			return _broadcastSegmented(clients, pieces, flags, accepted);
+		
+		const size_t nPieces = pieces.empty() ? 1 : pieces.size();
+		const size_t nDatagrams = clients.size() * nPieces;
+		
+		// Buffers pointing to the message (no copy) : fragment header, then the chunk in the message header and content
+		std::vector<struct iovec> iovecs(_IOV_BY_DATAGRAM * nDatagrams);
+		std::vector<struct mmsghdr> datagrams(nDatagrams);
+		
+		for(size_t iClient = 0; iClient < clients.size(); iClient++) {
+			for(size_t iPiece = 0; iPiece < nPieces; iPiece++) {
+				const size_t k = iClient * nPieces + iPiece;
+				struct iovec* iov = &iovecs[_IOV_BY_DATAGRAM * k];
+				
+				if(pieces.empty()) {
+					iov[0].iov_base = const_cast<char*>(msg.header());
+					iov[0].iov_len 	= Message::HEADER_SIZE;
+					iov[1].iov_base = const_cast<char*>(msg.content());
+					iov[1].iov_len 	= msg.size();
 				}
-				else { // Read data message
-					std::lock_guard<std::mutex> lockCbk(_mutCbk);
-					if(_cbkData) 
-						_cbkData(itClient->info, message);
+				else {
+					_setPiece(pieces[iPiece], iov);
 				}
-			}			
+				
+				_setDatagram(clients[iClient], iov, _IOV_BY_DATAGRAM, datagrams[k].msg_hdr);
+			}
+		}
+		
+		size_t sent = 0;
+		return _sendBatch(datagrams, sent, flags, accepted);
+	}
+	
+	// The fragments follow each other in one buffer, the kernel cuts it every DATAGRAM_SIZE (UDP_SEGMENT)
+	bool _broadcastSegmented(const std::vector<ClientInfo>& clients, const std::vector<Fragment::Piece>& pieces, int flags, size_t* accepted) const {
+		const size_t nPieces = pieces.size();
+		const size_t groupSize = (flags & MSG_ZEROCOPY) ? _ZEROCOPY_SEGMENTS : _GSO_SEGMENTS;
+		const size_t nGroups = (nPieces + groupSize - 1) / groupSize;
+		const size_t nDatagrams = clients.size() * nGroups;
+		
+		std::vector<struct iovec> iovecs(_IOV_BY_DATAGRAM * clients.size() * nPieces);
+		std::vector<struct mmsghdr> datagrams(nDatagrams);
+		std::vector<char> controls(nDatagrams * CMSG_SPACE(sizeof(uint16_t)), 0);
+		
+		for(size_t iClient = 0; iClient < clients.size(); iClient++) {
+			for(size_t iPiece = 0; iPiece < nPieces; iPiece++)
+				_setPiece(pieces[iPiece], &iovecs[_IOV_BY_DATAGRAM * (iClient * nPieces + iPiece)]);
+			
+			for(size_t iGroup = 0; iGroup < nGroups; iGroup++) {
+				const size_t k = iClient * nGroups + iGroup;
+				const size_t first = iGroup * groupSize;
+				const size_t count = std::min(nPieces - first, groupSize);
+				
+				struct msghdr& header(datagrams[k].msg_hdr);
+				_setDatagram(clients[iClient], &iovecs[_IOV_BY_DATAGRAM * (iClient * nPieces + first)], _IOV_BY_DATAGRAM * count, header);
+				
+				header.msg_control 		= &controls[k * CMSG_SPACE(sizeof(uint16_t))];
+				header.msg_controllen 	= CMSG_SPACE(sizeof(uint16_t));
+				
+				struct cmsghdr* cmsg = CMSG_FIRSTHDR(&header);
+				cmsg->cmsg_level 	= SOL_UDP;
+				cmsg->cmsg_type 	= UDP_SEGMENT;
+				cmsg->cmsg_len 		= CMSG_LEN(sizeof(uint16_t));
+				
+				const uint16_t segmentSize = (uint16_t)Fragment::DATAGRAM_SIZE;
+				memcpy(CMSG_DATA(cmsg), &segmentSize, sizeof(segmentSize));
+			}
+		}
+		
+		size_t sent = 0;
+		bool refused = false;
+		const bool success = _sendBatch(datagrams, sent, flags, accepted, &refused);
+		if(!refused)
+			return success;
+		
+		// Refused by the kernel or the route : back to one datagram by fragment, for good
+		_segmentOffload = false;
+		{
+			std::lock_guard<std::mutex> lockCbk(_mutCbk);
+			if(_cbkError) 
+				_cbkError(Error(wlc::getError(), "UDP segmentation offload not supported: disabled"));
+		}
+		
+		std::vector<struct mmsghdr> plain;
+		for(size_t k = sent; k < datagrams.size(); k++) {
+			const struct msghdr& header(datagrams[k].msg_hdr);
+			for(size_t iov = 0; iov < header.msg_iovlen; iov += _IOV_BY_DATAGRAM) {
+				struct mmsghdr datagram = {};
+				datagram.msg_hdr.msg_name 		= header.msg_name;
+				datagram.msg_hdr.msg_namelen 	= header.msg_namelen;
+				datagram.msg_hdr.msg_iov 		= header.msg_iov + iov;
+				datagram.msg_hdr.msg_iovlen 	= _IOV_BY_DATAGRAM;
+				plain.push_back(datagram);
+			}
+		}
+		
+		size_t sentPlain = 0;
+		return _sendBatch(plain, sentPlain, flags, accepted) && success;
+	}
+	
+	static void _setPiece(const Fragment::Piece& piece, struct iovec* iov) {
+		iov[0].iov_base = const_cast<char*>(piece.header);
+		iov[0].iov_len 	= Fragment::HEADER_SIZE;
+		iov[1].iov_base = const_cast<char*>(piece.data[0]);
+		iov[1].iov_len 	= piece.length[0];
+		iov[2].iov_base = const_cast<char*>(piece.data[1]);
+		iov[2].iov_len 	= piece.length[1];	// Often empty
+	}
+	static void _setDatagram(const ClientInfo& client, struct iovec* iov, size_t iovlen, struct msghdr& header) {
+		header.msg_name 	= const_cast<sockaddr_in*>(&client.udpAddress);
+		header.msg_namelen 	= sizeof(client.udpAddress);
+		header.msg_iov 		= iov;
+		header.msg_iovlen 	= iovlen;
+	}
+	
+	// From 'sent' : partial sends continue where they stopped, a full buffer is waited a bit, a failing datagram is skipped.
+	// Return false if a datagram was lost. With 'refused', a segmentation offload error stops it : 'refused' is set,
+	// 'sent' is the refused datagram and the return value is about the ones before it.
+	// 'accepted' counts the datagrams sent with MSG_ZEROCOPY, each one is a notification id.
+	bool _sendBatch(std::vector<struct mmsghdr>& datagrams, size_t& sent, int flags = 0, size_t* accepted = nullptr, bool* refused = nullptr) const {
+#ifdef URING_AVAILABLE
+		// Plain datagrams with io_uring (zero copy and segmentation offload : already one sendmmsg for many fragments)
+		if(_uring && flags == 0 && sent < datagrams.size() && datagrams[sent].msg_hdr.msg_controllen == 0 && _sendLinked(datagrams, sent))
+			return true;
+		if(sent >= datagrams.size())
+			return false;
+#endif
+		bool success = true;
+		
+		while(sent < datagrams.size()) {
+			const unsigned int count = (unsigned int)std::min(datagrams.size() - sent, (size_t)UIO_MAXIOV);
+			const int nSent = sendmmsg(_udpSock, &datagrams[sent], count, flags);
+			
+			if(nSent > 0) {
+				sent += (size_t)nSent;
+				if(accepted && (flags & MSG_ZEROCOPY))
+					*accepted += (size_t)nSent;
+				continue;
+			}
+			
+			const int error = wlc::getError();
+			if(nSent == -1 && error == EINTR)
+				continue;
+			
+			// Too many notifications waiting (optmem_max), or too many pages for one packet : the rest is copied
+			if(nSent == -1 && (error == ENOBUFS || error == EMSGSIZE) && (flags & MSG_ZEROCOPY)) {
+				flags &= ~MSG_ZEROCOPY;
+				continue;
+			}
+			
+			if(nSent == -1 && wlc::errorIs(wlc::WOULD_BLOCK, error)) {
+				struct pollfd fdp = {(int)_udpSock, POLLOUT, 0};
+				if(poll(&fdp, 1, _SEND_TIMEOUT_MS) > 0)
+					continue;
+				
+				std::lock_guard<std::mutex> lockCbk(_mutCbk);
+				if(_cbkError) 
+					_cbkError(Error(error, "UDP send Error: " + std::to_string(datagrams.size() - sent) + " datagrams dropped"));
+				
+				sent = datagrams.size();
+				return false;
+			}
 			
+			if(refused && datagrams[sent].msg_hdr.msg_controllen > 0 && (error == EIO || error == EINVAL || error == ENOPROTOOPT || error == EOPNOTSUPP || error == EMSGSIZE)) {
+				*refused = true;
+				return success;
+			}
+			
+			{
+				std::lock_guard<std::mutex> lockCbk(_mutCbk);
+				if(_cbkError) 
+					_cbkError(Error(error, "UDP send Error"));
+			}
+			success = false;
+			sent++;
 		}
+		
+		return success;
+	}
+#endif
+	
+	// Copy of a callback, to call it without _mutCbk : it may use the server (sendInfo() takes it on errors)
+	template <typename T>
+	T _callback(const T& cbk) const {
+		std::lock_guard<std::mutex> lockCbk(_mutCbk);
+		return cbk;
+	}
+	
+	void _recordLatency(uint64_t exposed) const {
+		if(exposed == 0)
+			return;
+		
+		const uint64_t now = Timer::monotonicMus();
+		if(now >= exposed)
+			_sendLatency.add(now - exposed);
+	}
+	
+	// Not thread safe - Please use mutex before calling, unless in the loop (Linux).
+	std::vector<ConnectedClient>::iterator _findClientFromId(SOCKET idClient) {
+		for(std::vector<ConnectedClient>::iterator itClient = _clients.begin(); itClient != _clients.end(); ++itClient) 
+			if(itClient->info.id == idClient) 
+				return itClient;
+				
+		return _clients.end();
+	}
+	std::vector<ConnectedClient>::const_iterator _findClientFromId(SOCKET idClient) const {
+		for(std::vector<ConnectedClient>::const_iterator itClient = _clients.begin(); itClient != _clients.end(); ++itClient) 
+			if(itClient->info.id == idClient) 
+				return itClient;
+				
+		return _clients.end();
 	}
 	
 	// Search in the list. Not thread safe - Please use mutex before calling.
@@ -409,6 +1781,72 @@ private:
 	}
 	
 private:
+	// Constants
+	static const int _SEND_TIMEOUT_MS = 20; // Socket buffer full for so long : the clients lose the rest
+	static const int _HANDSHAKE_RETRY_MS = 500; // Clients without udp asked again
+	static const int _MAX_EVENTS = 64;
+	static const size_t _TCP_BUFFER_SIZE = 2048;
+	static const size_t _TCP_MAX_PENDING = 64 << 10; // Longer than any request : the stream is lost
+	static const size_t _UDP_BUFFER_SIZE = 2048;
+	static const size_t _IOV_BY_DATAGRAM = 3;
+	static const size_t _GSO_SEGMENTS = 65507 / Fragment::DATAGRAM_SIZE; // Segments in one UDP payload (kernel limit: 64)
+	static const size_t _ZEROCOPY_MIN = 10 << 10; // Under it, pinning the pages and the notification cost more than the copy
+	static const size_t _ZEROCOPY_SEGMENTS = 5; // Pinned pages are packet fragments (17 max) : up to 3 by segment, the headers are apart
+	static const unsigned int _URING_ENTRIES = 256;
+	static const uint16_t _URING_TCP_BUFFERS = 64; 		// Power of 2
+	static const uint16_t _URING_UDP_BUFFERS = 128; 	// Power of 2
+	static const uint16_t _BUFFERS_TCP = 0; 			// Buffer rings ids
+	static const uint16_t _BUFFERS_UDP = 1;
+	static const uint64_t _SEND_CANCEL = ~0ULL;
+	static const int _URING_SEND_RETRIES = 100; // Send ring failing for so many ms : closed, back to sendmmsg
+	static const size_t _MAX_STREAMS = 64; // Bits of ClientInfo::streams
+	
+	// io_uring operations
+	enum _UringOp {
+		_OP_ACCEPT = 1, _OP_TCP, _OP_UDP, _OP_TIMER, _OP_STOP, _OP_ERRORS
+	};
+	
+#ifdef __linux__
+	// Structures
+	struct _ZeroCopyKept {
+		explicit _ZeroCopyKept(const Message& message) : msg(message) {
+		}
+		
+		Message msg;
+		std::vector<Fragment::Piece> pieces;
+	};
+	struct _ZeroCopySend {
+		uint32_t first;		// Notification ids [first, first + count[
+		uint32_t count;
+		uint32_t remaining;
+		std::shared_ptr<_ZeroCopyKept> pKept;
+	};
+#endif
+	
+	// Send queues
+	struct _Queued {
+		std::shared_ptr<const Message> pMsg;
+		uint64_t exposed;
+	};
+	struct _Queue {
+		std::deque<_Queued> items;
+		QueueStats stats;
+	};
+	struct _ClientQueues {
+		ClientInfo target;			// Latest infos of the client, or the group
+		std::vector<_Queue> streams;
+		size_t next = 0;			// Stream served first at the next turn
+	};
+	struct _Stream {
+		QueuePolicy policy;
+		size_t capacity;
+		QueueStats stats;			// Every client
+	};
+	struct _Batch {
+		_Queued item;
+		std::vector<ClientInfo> clients;
+	};
+	
 	// Members
 	std::atomic<bool> _isConnected;
 	
@@ -419,8 +1857,8 @@ private:
 	// Callbacks
 	mutable std::mutex _mutCbk;
 	std::function<void(const Error& error)> _cbkError;
-	std::function<void(const ClientInfo& client, const Message& message)> _cbkInfo;
-	std::function<void(const ClientInfo& client, const Message& message)> _cbkData;
+	std::function<void(const ClientInfo& client, const MessageView& message)> _cbkInfo;
+	std::function<void(const ClientInfo& client, const MessageView& message)> _cbkData;
 	std::function<void(const ClientInfo& client)> _cbkConnect;
 	std::function<void(const ClientInfo& client)> _cbkDisconnect;
 	
@@ -428,9 +1866,59 @@ private:
 	std::shared_ptr<std::thread> _pHandleTcp;
 	std::shared_ptr<std::thread> _pRecvUdp;
 	
+	// Event loop (Linux)
+	std::shared_ptr<std::thread> _pLoop;
+	int _epfd;
+	int _stopFd;
+	int _timerFd;
+	
+	// io_uring loop (Linux 6.0)
+	std::atomic<bool> _uringWanted;
+	std::atomic<bool> _uring;
+	bool _acceptArmed;
+#ifdef URING_AVAILABLE
+	Uring _ring;
+	Uring::BufferRing _tcpBuffers;
+	Uring::BufferRing _udpBuffers;
+	struct msghdr _udpHeader; 	// Receives : what the kernel puts before the datagram
+	struct __kernel_timespec _retryPeriod;
+	
+	mutable std::mutex _mutSendRing;
+	mutable Uring _sendRing;
+#endif
+	
 	// Clients
 	mutable std::mutex _mutClients;
 	std::vector<ConnectedClient> _clients;
 	std::vector<std::vector<ConnectedClient>::iterator> _garbageItClients;
+	
+	// Multicast
+	std::atomic<bool> _multicast;
+	ClientInfo _group; 		// Its address as the udp one
+	std::string _groupName; // "group:port"
+	
+	// Send queues, emptied by their thread
+	std::shared_ptr<std::thread> _pSend;
+	mutable std::mutex _mutQueues;
+	std::condition_variable _cvQueues;
+	bool _sending; 	// Under _mutQueues
+	std::vector<_Stream> _streams;
+	std::map<SOCKET, _ClientQueues> _queues; 	// By client id, the group at INVALID_SOCKET
+	
+	// Statistics
+	mutable Histogram _sendLatency;
+	
+	// Fragmented messages
+	mutable std::atomic<uint32_t> _sequence;
+	mutable std::atomic<bool> _segmentOffload;
+	
+	// Zero copy sends
+	std::atomic<bool> _zeroCopy;
+	mutable std::mutex _mutZeroCopy;
+	mutable uint32_t _zeroCopyNext;
+#ifdef __linux__
+	mutable std::vector<_ZeroCopySend> _zeroCopyPending;
+	mutable ZeroCopyStats _zeroCopyStats;
+#endif
 };
 
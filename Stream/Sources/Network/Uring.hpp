@@ -0,0 +1,338 @@
+#pragma once
+
+#if defined(__linux__) && defined(__has_include)
+	#if __has_include(<linux/io_uring.h>)
+		#include <linux/io_uring.h>
+	#endif
+#endif
+
+// Multishot receives (and so provided buffer rings) : kernel headers 6.0 and later
+#if defined(IORING_RECV_MULTISHOT) && defined(IORING_ACCEPT_MULTISHOT)
+	#define URING_AVAILABLE
+#endif
+
+#ifdef URING_AVAILABLE
+
+#include <cstdint>
+#include <cstring>
+#include <csignal>
+#include <cerrno>
+#include <memory>
+
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// ------------ Uring : io_uring without liburing, only what the transport needs ------------
+// One thread submits and reaps (no lock inside). Operations are queued with getSqe(), then sent with a single submit().
+class Uring {
+public:
+	// Constructor
+	Uring() :
+		_fd(-1), _sqRing(nullptr), _cqRing(nullptr), _sqes(nullptr), _sqRingSize(0), _cqRingSize(0), _sqesSize(0),
+		_sqHead(nullptr), _sqTail(nullptr), _sqMask(0), _sqEntries(0), _cqHead(nullptr), _cqTail(nullptr), _cqMask(0), _cqes(nullptr),
+		_sqTailLocal(0), _sqSubmitted(0)
+	{
+		// Wait for init()
+	}
+	Uring(const Uring&) = delete;
+	Uring& operator=(const Uring&) = delete;
+
+	// Destructor
+	~Uring() {
+		release();
+	}
+
+	// - Methods
+	// False if the kernel doesn't have it (< 5.1), or it's disabled (kernel.io_uring_disabled, seccomp)
+	bool init(unsigned int entries) {
+		if(_fd != -1)
+			return true;
+
+		struct io_uring_params params;
+		memset(&params, 0, sizeof(params));
+
+		_fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+		if(_fd < 0) {
+			_fd = -1;
+			return false;
+		}
+
+		// Completions never dropped, timeout on wait (5.11)
+		const unsigned int needed = IORING_FEAT_NODROP | IORING_FEAT_SUBMIT_STABLE | IORING_FEAT_EXT_ARG;
+		if((params.features & needed) != needed || !_map(params)) {
+			release();
+			return false;
+		}
+
+		return true;
+	}
+	void release() {
+		if(_sqes)
+			munmap(_sqes, _sqesSize);
+		if(_cqRing && _cqRing != _sqRing)
+			munmap(_cqRing, _cqRingSize);
+		if(_sqRing)
+			munmap(_sqRing, _sqRingSize);
+		if(_fd != -1)
+			close(_fd);
+
+		_fd 	= -1;
+		_sqRing = nullptr;
+		_cqRing = nullptr;
+		_sqes 	= nullptr;
+	}
+
+	// Next operation to fill, cleared. Null when the queue is full : submit() first.
+	struct io_uring_sqe* getSqe() {
+		if(_sqTailLocal - __atomic_load_n(_sqHead, __ATOMIC_ACQUIRE) >= _sqEntries)
+			return nullptr;
+
+		struct io_uring_sqe* sqe = &_sqes[_sqTailLocal & _sqMask];
+		memset(sqe, 0, sizeof(*sqe));
+		_sqTailLocal++;
+		return sqe;
+	}
+
+	// Send the queued operations and wait for 'waitNr' completions, at most 'timeoutMs' (-1 : no limit).
+	// One syscall. Return the operations submitted, -1 and errno on error (ETIME : timeout).
+	int submit(unsigned int waitNr = 0, int timeoutMs = -1) {
+		__atomic_store_n(_sqTail, _sqTailLocal, __ATOMIC_RELEASE);
+
+		const unsigned int toSubmit = _sqTailLocal - _sqSubmitted;
+		unsigned int flags = waitNr > 0 ? IORING_ENTER_GETEVENTS : 0;
+
+		struct __kernel_timespec timeout;
+		struct io_uring_getevents_arg arg;
+		memset(&arg, 0, sizeof(arg));
+
+		if(waitNr > 0 && timeoutMs >= 0) {
+			timeout.tv_sec 	= timeoutMs / 1000;
+			timeout.tv_nsec = (timeoutMs % 1000) * 1000000LL;
+			arg.sigmask_sz 	= _NSIG / 8;
+			arg.ts 			= (uint64_t)(uintptr_t)&timeout;
+			flags |= IORING_ENTER_EXT_ARG;
+		}
+
+		const int submitted = (int)syscall(__NR_io_uring_enter, _fd, toSubmit, waitNr, flags, (flags & IORING_ENTER_EXT_ARG) ? (void*)&arg : nullptr, sizeof(arg));
+		if(submitted > 0)
+			_sqSubmitted += (unsigned int)submitted;
+
+		return submitted;
+	}
+
+	// Call 'onCqe(const io_uring_cqe&)' for each completion ready, then give their slots back. Return how many.
+	template<typename Callback>
+	unsigned int reap(const Callback& onCqe) {
+		unsigned int head = *_cqHead;
+		const unsigned int tail = __atomic_load_n(_cqTail, __ATOMIC_ACQUIRE);
+
+		const unsigned int count = tail - head;
+		for(; head != tail; head++)
+			onCqe(_cqes[head & _cqMask]);
+
+		__atomic_store_n(_cqHead, head, __ATOMIC_RELEASE);
+		return count;
+	}
+
+	// Getters
+	bool isValid() const {
+		return _fd != -1;
+	}
+	int fd() const {
+		return _fd;
+	}
+	unsigned int entries() const {
+		return _sqEntries;
+	}
+
+	// Helpers to fill an operation
+	static void prepare(struct io_uring_sqe* sqe, uint8_t opcode, int fd, const void* addr, uint32_t len, uint64_t userData) {
+		sqe->opcode 	= opcode;
+		sqe->fd 		= fd;
+		sqe->addr 		= (uint64_t)(uintptr_t)addr;
+		sqe->len 		= len;
+		sqe->user_data 	= userData;
+	}
+
+
+	// ------------ BufferRing : Buffers the kernel picks for the receives (provided buffers ring, 5.19) ------------
+	// A completion tells which one : read it, then give() it back.
+	class BufferRing {
+	public:
+		// Constructor
+		BufferRing() : _ring(nullptr), _ringSize(0), _count(0), _size(0), _tail(0), _idGroup(0), _pUring(nullptr) {
+		}
+		BufferRing(const BufferRing&) = delete;
+		BufferRing& operator=(const BufferRing&) = delete;
+
+		// Destructor
+		~BufferRing() {
+			release();
+		}
+
+		// - Methods
+		// 'count' : power of 2
+		bool init(Uring& uring, uint16_t idGroup, uint16_t count, uint32_t size) {
+			if((count & (count - 1)) != 0)
+				return false;
+
+			_ringSize = count * sizeof(struct io_uring_buf);
+			void* ring = mmap(nullptr, _ringSize, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+			if(ring == MAP_FAILED)
+				return false;
+
+			_ring 		= (struct io_uring_buf_ring*)ring;
+			_count 		= count;
+			_size 		= size;
+			_idGroup 	= idGroup;
+			_tail 		= 0;
+			_buffers.reset(new char[(size_t)count * size]);
+
+			struct io_uring_buf_reg reg;
+			memset(&reg, 0, sizeof(reg));
+			reg.ring_addr 		= (uint64_t)(uintptr_t)_ring;
+			reg.ring_entries 	= count;
+			reg.bgid 			= idGroup;
+
+			if(syscall(__NR_io_uring_register, uring.fd(), IORING_REGISTER_PBUF_RING, &reg, 1) != 0) {
+				release();
+				return false;
+			}
+			_pUring = &uring;
+
+			for(uint16_t id = 0; id < count; id++)
+				give(id);
+			return true;
+		}
+		void release() {
+			if(_pUring && _pUring->isValid()) {
+				struct io_uring_buf_reg reg;
+				memset(&reg, 0, sizeof(reg));
+				reg.bgid = _idGroup;
+				syscall(__NR_io_uring_register, _pUring->fd(), IORING_UNREGISTER_PBUF_RING, &reg, 1);
+			}
+			if(_ring)
+				munmap(_ring, _ringSize);
+
+			_ring 	= nullptr;
+			_pUring = nullptr;
+			_buffers.reset();
+		}
+
+		// Back to the kernel
+		void give(uint16_t id) {
+			// Not _ring->bufs : in C++ the kernel header puts it after an empty struct (1 byte)
+			struct io_uring_buf& buf(reinterpret_cast<struct io_uring_buf*>(_ring)[_tail & (_count - 1)]);
+			buf.addr 	= (uint64_t)(uintptr_t)buffer(id);
+			buf.len 	= _size;
+			buf.bid 	= id;
+
+			_tail++;
+			__atomic_store_n(&_ring->tail, _tail, __ATOMIC_RELEASE);
+		}
+
+		// Getters
+		char* buffer(uint16_t id) const {
+			return _buffers.get() + (size_t)id * _size;
+		}
+		uint16_t group() const {
+			return _idGroup;
+		}
+		uint32_t size() const {
+			return _size;
+		}
+		// Buffer of a completion
+		static uint16_t idOf(const struct io_uring_cqe& cqe) {
+			return (uint16_t)(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+		}
+		static bool hasBuffer(const struct io_uring_cqe& cqe) {
+			return (cqe.flags & IORING_CQE_F_BUFFER) != 0;
+		}
+
+	private:
+		// Members
+		struct io_uring_buf_ring* _ring;
+		size_t _ringSize;
+		uint16_t _count;
+		uint32_t _size;
+		uint16_t _tail;
+		uint16_t _idGroup;
+		Uring* _pUring;
+		std::unique_ptr<char[]> _buffers;
+	};
+
+private:
+	// Methods
+	bool _map(const struct io_uring_params& params) {
+		_sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+		_cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+
+		// Both rings in one mapping (5.4)
+		const bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+		if(single)
+			_sqRingSize = _cqRingSize = (_sqRingSize > _cqRingSize ? _sqRingSize : _cqRingSize);
+
+		void* sqRing = mmap(nullptr, _sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _fd, IORING_OFF_SQ_RING);
+		if(sqRing == MAP_FAILED)
+			return false;
+		_sqRing = (char*)sqRing;
+
+		if(single) {
+			_cqRing = _sqRing;
+		}
+		else {
+			void* cqRing = mmap(nullptr, _cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _fd, IORING_OFF_CQ_RING);
+			if(cqRing == MAP_FAILED)
+				return false;
+			_cqRing = (char*)cqRing;
+		}
+
+		_sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+		void* sqes = mmap(nullptr, _sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _fd, IORING_OFF_SQES);
+		if(sqes == MAP_FAILED)
+			return false;
+		_sqes = (struct io_uring_sqe*)sqes;
+
+		_sqHead 	= (unsigned int*)(_sqRing + params.sq_off.head);
+		_sqTail 	= (unsigned int*)(_sqRing + params.sq_off.tail);
+		_sqMask 	= *(unsigned int*)(_sqRing + params.sq_off.ring_mask);
+		_sqEntries 	= params.sq_entries;
+		_cqHead 	= (unsigned int*)(_cqRing + params.cq_off.head);
+		_cqTail 	= (unsigned int*)(_cqRing + params.cq_off.tail);
+		_cqMask 	= *(unsigned int*)(_cqRing + params.cq_off.ring_mask);
+		_cqes 		= (struct io_uring_cqe*)(_cqRing + params.cq_off.cqes);
+
+		// Operation i always in slot i
+		unsigned int* array = (unsigned int*)(_sqRing + params.sq_off.array);
+		for(unsigned int i = 0; i < _sqEntries; i++)
+			array[i] = i;
+
+		_sqTailLocal = _sqSubmitted = *_sqTail;
+		return true;
+	}
+
+	// Members
+	int _fd;
+
+	char* _sqRing;
+	char* _cqRing;
+	struct io_uring_sqe* _sqes;
+	size_t _sqRingSize;
+	size_t _cqRingSize;
+	size_t _sqesSize;
+
+	unsigned int* _sqHead;
+	unsigned int* _sqTail;
+	unsigned int _sqMask;
+	unsigned int _sqEntries;
+	unsigned int* _cqHead;
+	unsigned int* _cqTail;
+	unsigned int _cqMask;
+	struct io_uring_cqe* _cqes;
+
+	unsigned int _sqTailLocal;	// Operations queued
+	unsigned int _sqSubmitted;	// Operations given to the kernel
+};
+
+#endif
@@ -17,7 +17,14 @@
 	#include <sys/select.h>
 	#include <sys/socket.h>
 	#include <sys/types.h>
+	#include <sys/uio.h>
+	#include <sys/epoll.h>
+	#include <sys/eventfd.h>
+	#include <sys/timerfd.h>
+	#include <poll.h>
 	#include <netinet/in.h>	
+	#include <netinet/udp.h>
+	#include <linux/errqueue.h>
 	#include <arpa/inet.h>
 	#include <fcntl.h>
 	#include <errno.h>
@@ -36,6 +43,23 @@
 		#define SOCKET_ERROR -1
 	#endif
 	
+	/* Zero copy (Linux 4.14, UDP 5.0), for older headers */
+	#ifndef SO_ZEROCOPY
+		#define SO_ZEROCOPY 60
+	#endif
+	
+	#ifndef MSG_ZEROCOPY
+		#define MSG_ZEROCOPY 0x4000000
+	#endif
+	
+	#ifndef SO_EE_ORIGIN_ZEROCOPY
+		#define SO_EE_ORIGIN_ZEROCOPY 5
+	#endif
+	
+	#ifndef SO_EE_CODE_ZEROCOPY_COPIED
+		#define SO_EE_CODE_ZEROCOPY_COPIED 1
+	#endif
+	
 // Windows	
 #elif _WIN32	
 	/* Includes */
@@ -153,6 +177,63 @@ namespace wlc {
 
 		return -1;
 	}
+	// Bursts of fragments : the kernel may cap it (net.core.rmem_max)
+	int setReceiveBuffer(SOCKET idSocket, int size) {
+		return setsockopt(idSocket, SOL_SOCKET, SO_RCVBUF, (const char*)&size, sizeof(size));
+	}
+	
+	// --- Reading addresses ---
+	int inetPton(const char* ipAddress, in_addr* address) {
+#ifdef _WIN32
+		return InetPton(AF_INET, ipAddress, address);
+#elif __linux__
+		return inet_pton(AF_INET, ipAddress, address);
+#endif
+
+		return -1;
+	}
+	
+	// --- Waiting for sockets ---
+	int pollSockets(struct pollfd* fds, unsigned long count, int timeoutMs) {
+#ifdef _WIN32
+		return WSAPoll(fds, count, timeoutMs);
+#elif __linux__
+		return poll(fds, (nfds_t)count, timeoutMs);
+#endif
+
+		return -1;
+	}
+	
+	// --- Sending header and content without joining them ---
+	int sendBuffers(SOCKET idSocket, const char* first, size_t firstLen, const char* second, size_t secondLen, const sockaddr_in* address = nullptr) {
+#ifdef _WIN32
+		WSABUF buffers[2];
+		buffers[0].len = (ULONG)firstLen;
+		buffers[0].buf = (CHAR*)first;
+		buffers[1].len = (ULONG)secondLen;
+		buffers[1].buf = (CHAR*)second;
+		
+		DWORD sent = 0;
+		if(WSASendTo(idSocket, buffers, 2, &sent, 0, (const sockaddr*)address, address ? sizeof(*address) : 0, NULL, NULL) != 0)
+			return SOCKET_ERROR;
+		return (int)sent;
+#elif __linux__
+		struct iovec iov[2];
+		iov[0].iov_base = (void*)first;
+		iov[0].iov_len 	= firstLen;
+		iov[1].iov_base = (void*)second;
+		iov[1].iov_len 	= secondLen;
+		
+		struct msghdr header = {};
+		header.msg_name 	= (void*)address;
+		header.msg_namelen 	= address ? sizeof(*address) : 0;
+		header.msg_iov 		= iov;
+		header.msg_iovlen 	= 2;
+		return (int)sendmsg(idSocket, &header, MSG_NOSIGNAL);
+#endif
+
+		return -1;
+	}
 	
 	// --- Closing sockets ---
 	void closeSocket(SOCKET idSocket) {
@@ -162,6 +243,14 @@ namespace wlc {
 		close(idSocket);
 #endif
 	}
+	// Both ways : the receiving thread sees the end of the connection, the socket is still to be closed
+	void shutdownSocket(SOCKET idSocket) {
+#ifdef _WIN32 
+		shutdown(idSocket, SD_BOTH);
+#elif __linux__
+		shutdown(idSocket, SHUT_RDWR);
+#endif
+	}
 
 
 }
@@ -0,0 +1,166 @@
+#pragma once
+
+#include <mutex>
+#include <deque>
+#include <vector>
+#include <string>
+#include <functional>
+
+#include "../Device/structures.hpp"
+#include "../MPU/Mpu_6050.hpp"
+#include "../Timer.hpp"
+
+// ------------ FrameSync : Pair each frame with the imu samples taken during its exposure ------------
+// Frames and samples must be stamped on the same clock (Timer::monotonicMus).
+class FrameSync {
+public:
+	// Structures
+	struct Bundle {
+		Gb::Frame frame;
+		uint64_t tBegin;	// Exposure interval [tBegin, tEnd[ (mus)
+		uint64_t tEnd;
+		std::vector<Mpu_6050::Data> samples;
+	};
+
+	typedef std::function<void(const Bundle&)> Callback;
+
+public:
+	// Constructor
+	explicit FrameSync(uint64_t maxWaitMus = 100000, uint64_t historyMus = 1000000) :
+		_maxWaitMus(maxWaitMus),
+		_historyMus(historyMus),
+		_lastSample(0)
+	{
+		// Wait for data
+	}
+
+	// - Methods
+	void onBundle(const Callback& cbkBundle) {
+		std::lock_guard<std::mutex> lockCbk(_mutCbk);
+		_cbkBundle = cbkBundle;
+	}
+
+	// Imu loop
+	void pushImu(const Mpu_6050::Data& data) {
+		{
+			std::lock_guard<std::mutex> lockData(_mutData);
+			_samples.push_back(data);
+			if(data.timestamp > _lastSample)
+				_lastSample = data.timestamp;
+
+			// Forget samples too old to belong to any frame to come
+			while(!_samples.empty() && _samples.front().timestamp + _historyMus < _lastSample)
+				_samples.pop_front();
+		}
+
+		_flush();
+	}
+
+	// Capture thread or frame subscriber
+	void pushFrame(const Gb::Frame& frame) {
+		if(frame.timestamp == 0) // Not stamped : can't be synchronized
+			return;
+
+		{
+			std::lock_guard<std::mutex> lockData(_mutData);
+			_frames.push_back(frame);
+		}
+
+		_flush();
+	}
+
+	// -- Serialization : [tBegin 8][tEnd 8][nSamples 4][samples: [time 8][7 x float 4]...][frame]
+	static std::string serialize(const Bundle& bundle) {
+		const size_t SAMPLE_SIZE = 8 + 7*4;
+
+		std::string buffer;
+		buffer.reserve(20 + bundle.samples.size()*SAMPLE_SIZE + bundle.frame.length());
+
+		_write(buffer, bundle.tBegin, 8);
+		_write(buffer, bundle.tEnd, 8);
+		_write(buffer, static_cast<uint64_t>(bundle.samples.size()), 4);
+
+		for(const Mpu_6050::Data& data : bundle.samples) {
+			_write(buffer, data.timestamp, 8);
+			_writeFloat(buffer, data.temperature);
+			_writeFloat(buffer, data.accel.x);
+			_writeFloat(buffer, data.accel.y);
+			_writeFloat(buffer, data.accel.z);
+			_writeFloat(buffer, data.gyro.x);
+			_writeFloat(buffer, data.gyro.y);
+			_writeFloat(buffer, data.gyro.z);
+		}
+
+		if(bundle.frame.length() > 0)
+			buffer.append(reinterpret_cast<const char*>(bundle.frame.start()), bundle.frame.length());
+
+		return buffer;
+	}
+
+private:
+	// Emit every frame whose exposure is covered by the samples, or waited too long
+	void _flush() {
+		std::vector<Bundle> ready;
+		{
+			std::lock_guard<std::mutex> lockData(_mutData);
+			const uint64_t now = Timer::monotonicMus();
+
+			while(!_frames.empty()) {
+				const Gb::Frame& frame(_frames.front());
+				const uint64_t tBegin = frame.timestamp;
+				const uint64_t tEnd 	= frame.timestamp + frame.exposure;
+
+				bool covered = (_lastSample >= tEnd);
+				bool expired = (now > tEnd + _maxWaitMus);
+				if(!covered && !expired)
+					break;
+
+				Bundle bundle;
+				bundle.frame 	= frame;
+				bundle.tBegin	= tBegin;
+				bundle.tEnd 	= tEnd;
+				for(const Mpu_6050::Data& data : _samples) {
+					if(data.timestamp >= tEnd)
+						break;
+					if(data.timestamp >= tBegin)
+						bundle.samples.push_back(data);
+				}
+
+				ready.push_back(std::move(bundle));
+				_frames.pop_front();
+			}
+		}
+
+		if(ready.empty())
+			return;
+
+		std::lock_guard<std::mutex> lockCbk(_mutCbk);
+		if(_cbkBundle)
+			for(const Bundle& bundle : ready)
+				_cbkBundle(bundle);
+	}
+
+	// Little endian, like Message
+	static void _write(std::string& buffer, uint64_t value, size_t nBytes) {
+		for(size_t i = 0; i < nBytes; i++)
+			buffer.push_back(static_cast<char>((value >> (8*i)) & 0xFF));
+	}
+	static void _writeFloat(std::string& buffer, double value) {
+		float f = static_cast<float>(value);
+		uint32_t bits = 0;
+		memcpy(&bits, &f, sizeof(bits));
+		_write(buffer, bits, 4);
+	}
+
+	// Members
+	const uint64_t _maxWaitMus;	// Frames without enough samples are emitted anyway after this delay
+	const uint64_t _historyMus;	// Samples kept
+
+	std::mutex _mutData;
+	std::deque<Gb::Frame> _frames;
+	std::deque<Mpu_6050::Data> _samples; // Sorted by time
+	uint64_t _lastSample;
+
+	std::mutex _mutCbk;
+	Callback _cbkBundle;
+};
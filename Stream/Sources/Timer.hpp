@@ -42,6 +42,29 @@ public:
 		return static_cast<uint64_t>(std::chrono::time_point_cast<std::chrono::milliseconds>(std::chrono::system_clock::now()).time_since_epoch().count());
 	}
 
+	// Same clock as the V4L2 buffers (CLOCK_MONOTONIC), in microseconds
+	static uint64_t monotonicMus() {
+#ifdef __linux__
+		struct timespec ts;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		return static_cast<uint64_t>(ts.tv_sec) * 1000000 + static_cast<uint64_t>(ts.tv_nsec / 1000);
+#else
+		return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+	}
+
+	// Cpu time used by the calling thread, in microseconds (0 if unavailable)
+	static uint64_t threadCpuMus() {
+#ifdef __linux__
+		struct timespec ts;
+		if(clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0)
+			return 0;
+		return static_cast<uint64_t>(ts.tv_sec) * 1000000 + static_cast<uint64_t>(ts.tv_nsec / 1000);
+#else
+		return 0;
+#endif
+	}
+
 	static void wait(int ms) {
 		if(ms > 0)
 			std::this_thread::sleep_for(std::chrono::milliseconds(ms));
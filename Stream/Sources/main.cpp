@@ -1,67 +1,145 @@
 #include <iostream>
 #include <csignal>
+#include <cstdlib>
 #include <atomic>
-#include <map>
 #include <deque>
+#include <algorithm>
 
 #include "Device/DeviceMt.hpp"
+#include "Device/Simulcast.hpp"
+#include "Device/MotionGate.hpp"
+#include "Device/RateController.hpp"
 #include "Network/Server.hpp"
 #include "Network/Message.hpp"
+#include "Network/MpuPayload.hpp"
 #include "Timer.hpp"
 
 #include "MPU/Mpu_6050.hpp"
+#include "Sync/FrameSync.hpp"
 
 namespace Globals {
 	// Constantes
 	const int PORT = 8888;
+	const std::string MULTICAST_GROUP = "239.255.88.88";
+	const int MULTICAST_PORT = 8889;
+	const int MPU_ADDRESS = 0x68;
 	const std::string PATH_CAMERA = "/dev/video0";
 	
 	// Variables
 	volatile std::sig_atomic_t signalStatus = 0;
 }
 
-// --- Structures ---
-struct ClientRequest {
-	bool play;
-};
-
 // --- Signals ---
 static void sigintHandler(int signal) {
 	Globals::signalStatus = signal;
 }
 
 // --- Entry point ---
-int main() {
+// Optional argument : video source, see Device (ex: "synthetic:640x480?fps=30" to run without camera)
+int main(int argc, char* argv[]) {
 	// -- Install signal handler
 	std::signal(SIGINT, sigintHandler);
 	
 	// Variables
 	Server server;
 	DeviceMt device;
-	std::map<SOCKET, ClientRequest> mapRequests;
+	FrameSync sync;
+	Simulcast simulcast;
+	MotionGate motionGate;
+	RateController rateController(device);
+	uint64_t networkDropped = 0;
+	uint64_t queueDropped = 0;
 	
 	// -- Connect server --
+	server.preferUring(true); // epoll if the kernel doesn't have it
 	server.connectAt(Globals::PORT);
+	server.setSegmentOffload(true); // Falls back to one datagram by fragment if the kernel refuses
+	server.setZeroCopy(true); // Camera frames only, kept until the kernel has sent them
+	server.setMulticast(Globals::MULTICAST_GROUP, Globals::MULTICAST_PORT); // One copy for the viewers of the full resolution
+	
+	// Sent by the server thread : a slow client only loses its own messages. The clients subscribe to them.
+	simulcast.addLayer(2, 60); // 320x240
+	simulcast.addLayer(4, 50); // 160x120
+	
+	std::vector<int> idCameras; // Frames and stills, by simulcast layer
+	for(size_t idLayer = 0; idLayer < simulcast.count(); idLayer++)
+		idCameras.push_back(server.addStream(Server::LatestOnly));
+	const int idImu 	= server.addStream(Server::DropOldest, 64); // Text samples
+	const int idImuRaw 	= server.addStream(Server::DropOldest, 64); // Binary samples (MpuPayload)
+	const int idBundle 	= server.addStream(Server::DropOldest, 8); // Frames and imu bundled together
 	
 	server.onClientConnect([&](const Server::ClientInfo& client) {
 		std::cout << "New client, client_" << client.id << std::endl;
-		mapRequests[client.id].play = false;
 	});
 	server.onClientDisconnect([&](const Server::ClientInfo& client) {
 		std::cout << "Client quit, client_" << client.id << std::endl;
-		mapRequests[client.id].play = false;
 	});
 	server.onError([&](const Error& error) {
 		std::cout << "Error : " << error.msg() << std::endl;
 	});
 	
-	server.onInfo([&](const Server::ClientInfo& client, const Message& message) {
+	server.onInfo([&](const Server::ClientInfo& client, const MessageView& message) {
 		std::cout << "Info received from client_" << client.id << ": [Code:" << message.code() << "] " << message.str() << std::endl;
-		if(message.code() == Message::TEXT && message.str() == "Send") {
-			mapRequests[client.id].play = true;
+		// "Send" : full resolution, "Send:n" : simulcast layer n. Option "?mpu=1" : binary imu samples, else text
+		const std::string text = message.str();
+		const std::string request = text.substr(0, text.find('?'));
+		const bool sync = server.isSubscribed(client, idBundle); // The bundles only, for good
+		if(message.code() == Message::TEXT && (request == "Send" || request.compare(0, 5, "Send:") == 0) && !sync) {
+			const size_t layer = request.size() > 5 ? (size_t)std::atoi(request.c_str() + 5) : 0;
+			for(size_t idLayer = 0; idLayer < idCameras.size(); idLayer++)
+				server.subscribe(client, idCameras[idLayer], idLayer == layer);
+			
+			const bool mpuBinary = text.find("?mpu=1") != std::string::npos;
+			server.subscribe(client, idImu, !mpuBinary);
+			server.subscribe(client, idImuRaw, mpuBinary);
+			
+			// Same streams for all of them : camera layer 0 and imu (the server only invites the clients with the streams of the group)
+			if(layer == 0 && !sync)
+				server.inviteMulticast(client);
+		}
+		// "Sync" : only the bundles
+		if(message.code() == Message::TEXT && message.is("Sync")) {
+			for(int idCamera : idCameras)
+				server.unsubscribe(client, idCamera);
+			server.unsubscribe(client, idImu);
+			server.unsubscribe(client, idImuRaw);
+			server.subscribe(client, idBundle);
+		}
+		// "Stats" : drops and latencies since exposure (mus)
+		if(message.code() == Message::TEXT && message.is("Stats")) {
+			MessageFormat msgStats;
+			msgStats.add("dropped", device.getCaptureStats().dropped);
+			const Server::ZeroCopyStats zeroCopy = server.getZeroCopyStats();
+			msgStats.add("zerocopy_sends", zeroCopy.sends);
+			msgStats.add("zerocopy_copied", zeroCopy.copied);
+			
+			Server::QueueStats queueCamera;
+			for(int idCamera : idCameras) {
+				const Server::QueueStats queueLayer = server.getQueueStats(client, idCamera);
+				queueCamera.queued += queueLayer.queued;
+				queueCamera.dropped += queueLayer.dropped;
+			}
+			const Server::QueueStats queueImu = server.getQueueStats(client, idImu);
+			msgStats.add("camera_queued", queueCamera.queued);
+			msgStats.add("camera_dropped", queueCamera.dropped);
+			msgStats.add("imu_queued", queueImu.queued);
+			msgStats.add("imu_dropped", queueImu.dropped);
+			
+			const std::pair<std::string, Histogram::Summary> stages[] = {
+				std::make_pair("dequeued", device.getLatency(DeviceMt::Dequeued)),
+				std::make_pair("retrieved", device.getLatency(DeviceMt::Retrieved)),
+				std::make_pair("delivered", device.getLatency(DeviceMt::Delivered)),
+				std::make_pair("sent", server.getSendLatency())
+			};
+			for(const auto& stage : stages) {
+				msgStats.add(stage.first + "_p50", stage.second.p50);
+				msgStats.add(stage.first + "_p99", stage.second.p99);
+				msgStats.add(stage.first + "_p999", stage.second.p999);
+			}
+			server.sendInfo(client, Message(msgStats.str()));
 		}
 	});
-	server.onData([&](const Server::ClientInfo& client, const Message& message) {
+	server.onData([&](const Server::ClientInfo& client, const MessageView& message) {
 		std::cout << "Data received from client_" << client.id << ": [Code:" << message.code() << "] " << message.str() << std::endl;
 	});
 	
@@ -70,19 +148,74 @@ int main() {
 	std::deque<double> freq(100, 0.0);
 	
 	// -- Open devices --	
-	if(device.open(Globals::PATH_CAMERA)) {
-		// Params
-		device.setFormat(640, 480, Device::MJPG);	
+	const std::string pathCamera = argc > 1 ? argv[1] : Globals::PATH_CAMERA;
+	if(device.open(pathCamera)) {
+		// Params : a replay or synthetic source has its own ("synthetic:320x240?format=yuyv")
+		if(pathCamera.compare(0, 5, "file:") != 0 && pathCamera.compare(0, 10, "synthetic:") != 0)
+			device.setFormat(640, 480, Device::MJPG);	
+		
+		// Events : network in its own thread, a slow client only loses frames
+		int idNetwork = device.subscribe([&](const Gb::Frame& frame) {
+			// Nobody watches : don't even decode it for the motion gate
+			if(std::none_of(idCameras.begin(), idCameras.end(), [&](int idCamera) { return server.hasSubscribers(idCamera); }))
+				return;
+
+			// Static scene : only tell the viewers
+			if(!motionGate.update(frame)) {
+				for(int idCamera : idCameras)
+					server.broadcastData(idCamera, Message(Message::STILL, std::to_string(frame.timestamp)));
+				return;
+			}
+			
+			// Send camera frame, each layer is encoded once and only if someone wants it
+			for(size_t idLayer = 0; idLayer < idCameras.size(); idLayer++) {
+				// The message refers to the encoded frame, which lives as long as the message
+				std::shared_ptr<Gb::Frame> pLayer = std::make_shared<Gb::Frame>();
+				if(!server.hasSubscribers(idCameras[idLayer]) || !simulcast.encode(frame, (int)idLayer, *pLayer))
+					continue;
+				
+				server.broadcastData(idCameras[idLayer], Message(Message::CAMERA, reinterpret_cast<const char*>(pLayer->start()), pLayer->length(), pLayer), frame.timestamp);
+			}
+		}, FrameHub::Options(1, FrameHub::LatestOnly));
 		
-		// Events		
-		device.onFrame([&](const Gb::Frame& frame) {		
-			// Send camera frame
-			for(auto& client: server.getClients()) {
-				if(client.connected && mapRequests[client.id].play) {
-					server.sendData(client, Message(Message::CAMERA, reinterpret_cast<const char*>(frame.start()), frame.length()));
-				}
+		// Synchronization with the imu : keep every frame, the bundles are sent when complete
+		device.subscribe([&](const Gb::Frame& frame) {
+			sync.pushFrame(frame);
+		}, FrameHub::Options(8, FrameHub::DropOldest));
+		
+		sync.onBundle([&](const FrameSync::Bundle& bundle) {
+			if(server.hasSubscribers(idBundle))
+				server.broadcastData(idBundle, Message(Message::BUNDLE, FrameSync::serialize(bundle)), bundle.frame.timestamp);
+		});
+		
+		// Frame rate : lowest when nobody watches, lower when the network can't follow
+		rateController.onDemand([&]() {
+			for(int idCamera : idCameras)
+				if(server.hasSubscribers(idCamera))
+					return 30.0;
+			return server.hasSubscribers(idBundle) ? 30.0 : 0.0;
+		});
+		
+		rateController.onBacklog([&, idNetwork]() {
+			FrameHub::Stats stats;
+			if(!device.getStats(idNetwork, stats))
+				return (size_t)0;
+			
+			size_t backlog = stats.queued + (size_t)(stats.dropped - networkDropped);
+			networkDropped = stats.dropped;
+			
+			// Frames replaced in the send queues : the network is the bottleneck
+			Server::QueueStats queue;
+			for(int idCamera : idCameras) {
+				const Server::QueueStats queueLayer = server.getQueueStats(idCamera);
+				queue.queued += queueLayer.queued;
+				queue.dropped += queueLayer.dropped;
 			}
+			backlog += queue.queued + (size_t)(queue.dropped - queueDropped);
+			queueDropped = queue.dropped;
+			return backlog;
 		});
+		rateController.start();
 	}
 	
 
@@ -90,15 +223,45 @@ int main() {
 	// -------- Main loop --------  
 	// Connect mpu
 	Mpu_6050 mpu;
-	if(!mpu.open("/dev/i2c-1", 0x68)) {
+	if(!mpu.open("/dev/i2c-1", Globals::MPU_ADDRESS)) {
 		std::cout << "Could not open the i2c slave" << std::endl;
 	}
 	
+	// Binary : the raw values, converted by the clients
+	MpuPayload::Header mpuHeader;
+	mpuHeader.sensor 			= (uint8_t)Globals::MPU_ADDRESS;
+	mpuHeader.accelScale 		= (float)Mpu_6050::accelScale();
+	mpuHeader.gyroScale 		= (float)Mpu_6050::gyroScale();
+	mpuHeader.temperatureScale 	= (float)Mpu_6050::temperatureScale();
+	mpuHeader.temperatureOffset = (float)Mpu_6050::temperatureOffset();
+	
 	Mpu_6050::Data data;
+	std::vector<MpuPayload::Sample> samples;
 	for(Timer timer; Globals::signalStatus != SIGINT; timer.wait(1)) {
-		if(mpu.acquireData(data)) {	
-			// Create message
+		// Every sample waiting in the fifo : one binary message for all of them
+		samples.clear();
+		while(samples.size() < 64 && mpu.acquireData(data)) {	
+			sync.pushImu(data);
+			
+			if(samples.empty())
+				mpuHeader.timestamp = data.timestamp;
+			
+			MpuPayload::Sample sample;
+			sample.accel[0] 	= data.raw[0];
+			sample.accel[1] 	= data.raw[1];
+			sample.accel[2] 	= data.raw[2];
+			sample.temperature 	= data.raw[3];
+			sample.gyro[0] 		= data.raw[4];
+			sample.gyro[1] 		= data.raw[5];
+			sample.gyro[2] 		= data.raw[6];
+			samples.push_back(sample);
+			
+			// Text : one message by sample, for the older clients
+			if(!server.hasSubscribers(idImu))
+				continue;
+			
 			MessageFormat msgMpu;
+			msgMpu.add("timestamp", data.timestamp);
 			msgMpu.add("temperature", data.temperature);
 			msgMpu.add("accel_x", data.accel.x);
 			msgMpu.add("accel_y", data.accel.y);
@@ -106,17 +269,18 @@ int main() {
 			msgMpu.add("gyro_x", data.gyro.x);
 			msgMpu.add("gyro_y", data.gyro.y);
 			msgMpu.add("gyro_z", data.gyro.z);
-			
-			// Send Mpu
-			for(auto& client: server.getClients()) {
-				if(client.connected && mapRequests[client.id].play) {
-					server.sendData(client, Message(Message::MPU, msgMpu.str()));
-				}
-			}
+			server.broadcastData(idImu, Message(Message::MPU, msgMpu.str()));
+		}
+		
+		// Send Mpu
+		if(!samples.empty() && server.hasSubscribers(idImuRaw)) {
+			mpuHeader.period = (uint32_t)mpu.samplePeriod();
+			server.broadcastData(idImuRaw, Message(Message::MPU, MpuPayload::encode(mpuHeader, samples)));
 		}
 	}
 		
 	// -- End
+	rateController.stop();
 	device.release();
 	server.disconnect();
 	
@@ -1,4 +1,4 @@
 g++ -std=gnu++11 \
 Sources/main.cpp Sources/Device/Device.cpp \
 -o streamSensors \
--lpthread
+-lpthread -ljpeg